@@ -0,0 +1,177 @@
+// Microbenchmark: blocked rotate_90 against the column walking loop
+// blit_portrait_to_screen used before it, and portrait page frames drawn
+// through the portrait surface against drawn straight onto the screen.
+// Run on the device: make bench
+#include "rotate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define PORTRAIT_WIDTH 768
+#define PORTRAIT_HEIGHT 1024
+#define RUNS 20
+
+static double now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// The previous blit_portrait_to_screen loop, kept as the baseline
+static void legacy_rotate(SDL_Surface *portrait, SDL_Surface *screen, int clockwise) {
+    int src_w = portrait->w;
+    int src_h = portrait->h;
+    int bpp = portrait->format->BytesPerPixel;
+
+    for (int dy = 0; dy < screen->h; dy++) {
+        const Uint8 *src;
+        int step;
+        if (!clockwise) {
+            src = (const Uint8 *)portrait->pixels + (src_w - 1 - dy) * bpp;
+            step = portrait->pitch;
+        } else {
+            src = (const Uint8 *)portrait->pixels + (src_h - 1) * portrait->pitch + dy * bpp;
+            step = -portrait->pitch;
+        }
+        Uint8 *dst_row = (Uint8 *)screen->pixels + dy * screen->pitch;
+
+        if (bpp == 2) {
+            Uint16 *dst = (Uint16 *)dst_row;
+            for (int dx = 0; dx < screen->w; dx++, src += step) {
+                dst[dx] = *(const Uint16 *)src;
+            }
+        } else {
+            Uint32 *dst = (Uint32 *)dst_row;
+            for (int dx = 0; dx < screen->w; dx++, src += step) {
+                dst[dx] = *(const Uint32 *)src;
+            }
+        }
+    }
+}
+
+static void blocked_rotate(SDL_Surface *portrait, SDL_Surface *screen, int clockwise) {
+    rotate_90(portrait, screen, clockwise, NULL);
+}
+
+// Zoomed frames sample the page at 1.5x, as the reader does
+static int zoom_xmap[PORTRAIT_WIDTH];
+static int zoom_ymap[PORTRAIT_HEIGHT];
+
+static void draw_page(View *view, SDL_Surface *page, int zoomed) {
+    if (zoomed) {
+        view_blit_mapped(view, page, zoom_xmap, zoom_ymap, 0, 0, PORTRAIT_WIDTH, PORTRAIT_HEIGHT);
+    } else {
+        view_blit(view, page, NULL, 0, 0);
+    }
+}
+
+// The page onto the portrait surface, then the surface onto the screen
+static void frame_via_surface(SDL_Surface *page, SDL_Surface *portrait, SDL_Surface *screen,
+                              int clockwise, int zoomed) {
+    View view;
+    view_init(&view, portrait, 0, NULL);
+    draw_page(&view, page, zoomed);
+    rotate_90(portrait, screen, clockwise, NULL);
+}
+
+// The page onto the screen through the rotated view
+static void frame_direct(SDL_Surface *page, SDL_Surface *portrait, SDL_Surface *screen,
+                         int clockwise, int zoomed) {
+    (void)portrait;
+    View view;
+    view_init(&view, screen, clockwise ? 2 : 1, NULL);
+    draw_page(&view, page, zoomed);
+}
+
+// Best time of RUNS frames
+static double time_frame(const char *name, int zoomed, SDL_Surface *page,
+                         SDL_Surface *portrait, SDL_Surface *screen,
+                         void (*frame)(SDL_Surface *, SDL_Surface *, SDL_Surface *, int, int)) {
+    double best = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now_ms();
+        frame(page, portrait, screen, run & 1, zoomed);
+        double elapsed = now_ms() - start;
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    printf("  %-8s %-6s %8.2f ms\n", name, zoomed ? "zoomed" : "fit", best);
+    return best;
+}
+
+// Best time of RUNS runs
+static double time_rotator(const char *name, int bpp, int clockwise,
+                           SDL_Surface *src, SDL_Surface *dst,
+                           void (*rotator)(SDL_Surface *, SDL_Surface *, int)) {
+    double best = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now_ms();
+        rotator(src, dst, clockwise);
+        double elapsed = now_ms() - start;
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    printf("  %-8s %d-bit %-4s %8.2f ms\n", name, bpp * 8, clockwise ? "CW" : "CCW", best);
+    return best;
+}
+
+int main(void) {
+    printf("Rotating %dx%d, best of %d, kernels: %s\n",
+           PORTRAIT_WIDTH, PORTRAIT_HEIGHT, RUNS, rotate_kernel_name());
+
+    for (int bpp = 2; bpp <= 4; bpp += 2) {
+        SDL_Surface *src = SDL_CreateRGBSurface(SDL_SWSURFACE, PORTRAIT_WIDTH, PORTRAIT_HEIGHT,
+                                                bpp * 8, 0, 0, 0, 0);
+        SDL_Surface *legacy = SDL_CreateRGBSurface(SDL_SWSURFACE, PORTRAIT_HEIGHT, PORTRAIT_WIDTH,
+                                                   bpp * 8, 0, 0, 0, 0);
+        SDL_Surface *blocked = SDL_CreateRGBSurface(SDL_SWSURFACE, PORTRAIT_HEIGHT, PORTRAIT_WIDTH,
+                                                    bpp * 8, 0, 0, 0, 0);
+        if (!src || !legacy || !blocked) {
+            fprintf(stderr, "Failed to create surfaces\n");
+            return 1;
+        }
+
+        Uint8 *pixels = (Uint8 *)src->pixels;
+        for (int i = 0; i < src->pitch * src->h; i++) {
+            pixels[i] = (Uint8)rand();
+        }
+
+        for (int clockwise = 0; clockwise <= 1; clockwise++) {
+            double old = time_rotator("column", bpp, clockwise, src, legacy, legacy_rotate);
+            double now = time_rotator("blocked", bpp, clockwise, src, blocked, blocked_rotate);
+
+            int same = 1;
+            for (int y = 0; y < legacy->h; y++) {
+                if (memcmp((Uint8 *)legacy->pixels + y * legacy->pitch,
+                           (Uint8 *)blocked->pixels + y * blocked->pitch,
+                           legacy->w * bpp) != 0) {
+                    same = 0;
+                }
+            }
+            printf("  blocked takes %.2fx the time of column%s\n", now / old,
+                   same ? "" : "  OUTPUT DIFFERS");
+        }
+
+        // Portrait page frames, src standing in for the page
+        for (int i = 0; i < PORTRAIT_WIDTH; i++) zoom_xmap[i] = i * 2 / 3;
+        for (int j = 0; j < PORTRAIT_HEIGHT; j++) zoom_ymap[j] = j * 2 / 3;
+        SDL_Surface *portrait = SDL_CreateRGBSurface(SDL_SWSURFACE, PORTRAIT_WIDTH, PORTRAIT_HEIGHT,
+                                                     bpp * 8, 0, 0, 0, 0);
+        if (!portrait) {
+            fprintf(stderr, "Failed to create surfaces\n");
+            return 1;
+        }
+        for (int zoomed = 0; zoomed <= 1; zoomed++) {
+            double old = time_frame("surface", zoomed, src, portrait, legacy, frame_via_surface);
+            double now = time_frame("direct", zoomed, src, portrait, blocked, frame_direct);
+            int same = memcmp(legacy->pixels, blocked->pixels, legacy->pitch * legacy->h) == 0;
+            printf("  direct takes %.2fx the time of surface%s\n", now / old,
+                   same ? "" : "  OUTPUT DIFFERS");
+        }
+
+        SDL_FreeSurface(portrait);
+        SDL_FreeSurface(src);
+        SDL_FreeSurface(legacy);
+        SDL_FreeSurface(blocked);
+    }
+    return 0;
+}
@@ -0,0 +1,93 @@
+// Microbenchmark: area-averaging scale_area against the nearest neighbour
+// loop scale_surface used before it. Run on the device: make bench
+#include "scale.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define SRC_WIDTH 2400
+#define SRC_HEIGHT 3600
+#define DST_WIDTH 768   // Fit into the 1536x1152 cache size
+#define DST_HEIGHT 1152
+#define RUNS 10
+
+static double now_ms(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// The previous scale_surface inner loop, kept as the baseline
+static void legacy_scale(SDL_Surface *src, SDL_Surface *dst) {
+    float scale = (float)dst->w / src->w;
+    Uint8 *src_pixels = (Uint8 *)src->pixels;
+    Uint8 *dst_pixels = (Uint8 *)dst->pixels;
+    int bpp = src->format->BytesPerPixel;
+
+    for (int y = 0; y < dst->h; y++) {
+        float src_y = y / scale;
+        int src_y_int = (int)src_y;
+        if (src_y_int >= src->h - 1) src_y_int = src->h - 2;
+
+        for (int x = 0; x < dst->w; x++) {
+            float src_x = x / scale;
+            int src_x_int = (int)src_x;
+            if (src_x_int >= src->w - 1) src_x_int = src->w - 2;
+
+            Uint8 *src_pixel = src_pixels + src_y_int * src->pitch + src_x_int * bpp;
+            Uint8 *dst_pixel = dst_pixels + y * dst->pitch + x * bpp;
+            memcpy(dst_pixel, src_pixel, bpp);
+        }
+    }
+}
+
+static void area_scale(SDL_Surface *src, SDL_Surface *dst) {
+    scale_area(src, dst);
+}
+
+// Best time of RUNS runs
+static double time_scaler(const char *name, int bpp, SDL_Surface *src, SDL_Surface *dst,
+                          void (*scaler)(SDL_Surface *, SDL_Surface *)) {
+    double best = 0;
+    for (int run = 0; run < RUNS; run++) {
+        double start = now_ms();
+        scaler(src, dst);
+        double elapsed = now_ms() - start;
+        if (run == 0 || elapsed < best) best = elapsed;
+    }
+    printf("  %-8s %d-bit: %8.2f ms\n", name, bpp * 8, best);
+    return best;
+}
+
+int main(void) {
+    printf("Scaling %dx%d -> %dx%d, best of %d, kernels: %s\n",
+           SRC_WIDTH, SRC_HEIGHT, DST_WIDTH, DST_HEIGHT, RUNS, scale_kernel_name());
+
+    for (int bpp = 3; bpp <= 4; bpp++) {
+        SDL_Surface *src = SDL_CreateRGBSurface(SDL_SWSURFACE, SRC_WIDTH, SRC_HEIGHT, bpp * 8,
+                                                0x0000FF, 0x00FF00, 0xFF0000, 0);
+        SDL_Surface *dst = SDL_CreateRGBSurface(SDL_SWSURFACE, DST_WIDTH, DST_HEIGHT, bpp * 8,
+                                                0x0000FF, 0x00FF00, 0xFF0000, 0);
+        if (!src || !dst) {
+            fprintf(stderr, "Failed to create surfaces\n");
+            return 1;
+        }
+
+        // Line-art-like content: thin strokes on a gradient
+        for (int y = 0; y < SRC_HEIGHT; y++) {
+            Uint8 *row = (Uint8 *)src->pixels + y * src->pitch;
+            for (int x = 0; x < SRC_WIDTH * bpp; x++) {
+                row[x] = ((x / bpp + y) % 7 == 0) ? 0 : (Uint8)(x * 255 / (SRC_WIDTH * bpp));
+            }
+        }
+
+        double legacy = time_scaler("nearest", bpp, src, dst, legacy_scale);
+        double area = time_scaler("area", bpp, src, dst, area_scale);
+        printf("  area takes %.2fx the time of nearest\n", area / legacy);
+
+        SDL_FreeSurface(src);
+        SDL_FreeSurface(dst);
+    }
+    return 0;
+}
@@ -0,0 +1,160 @@
+/* iommap.c -- IO base function header for compress/uncompress .zip
+   Read-only memory mapped files, see iommap.h
+*/
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "iommap.h"
+
+typedef struct
+{
+    const unsigned char* data;  /* mapping, NULL when using the stdio fallback */
+    ZPOS64_T size;
+    ZPOS64_T pos;
+    FILE* file;
+} MMAP_FILE;
+
+static voidpf ZCALLBACK mmap_open64_file_func(voidpf opaque, const void* filename, int mode) {
+    MMAP_FILE* mf;
+    struct stat st;
+    int fd;
+
+    if ((filename == NULL) || ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ))
+        return NULL;
+
+    mf = (MMAP_FILE*)calloc(1, sizeof(MMAP_FILE));
+    if (mf == NULL)
+        return NULL;
+
+    fd = open((const char*)filename, O_RDONLY);
+    if (fd >= 0) {
+        if ((fstat(fd, &st) == 0) && (st.st_size > 0) && ((ZPOS64_T)st.st_size == (size_t)st.st_size)) {
+            void* map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED) {
+                mf->data = (const unsigned char*)map;
+                mf->size = (ZPOS64_T)st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    if (mf->data == NULL) {
+        mf->file = fopen((const char*)filename, "rb");
+        if (mf->file == NULL) {
+            free(mf);
+            return NULL;
+        }
+    }
+
+    if (opaque != NULL) {
+        ((mmap_file_view*)opaque)->data = mf->data;
+        ((mmap_file_view*)opaque)->size = mf->size;
+    }
+    return mf;
+}
+
+static uLong ZCALLBACK mmap_read_file_func(voidpf opaque, voidpf stream, void* buf, uLong size) {
+    MMAP_FILE* mf = (MMAP_FILE*)stream;
+    (void)opaque;
+
+    if (mf->data == NULL)
+        return (uLong)fread(buf, 1, (size_t)size, mf->file);
+
+    if (mf->pos >= mf->size)
+        return 0;
+    if (size > mf->size - mf->pos)
+        size = (uLong)(mf->size - mf->pos);
+    memcpy(buf, mf->data + mf->pos, size);
+    mf->pos += size;
+    return size;
+}
+
+static uLong ZCALLBACK mmap_write_file_func(voidpf opaque, voidpf stream, const void* buf, uLong size) {
+    (void)opaque;
+    (void)stream;
+    (void)buf;
+    (void)size;
+    return 0;
+}
+
+static ZPOS64_T ZCALLBACK mmap_tell64_file_func(voidpf opaque, voidpf stream) {
+    MMAP_FILE* mf = (MMAP_FILE*)stream;
+    (void)opaque;
+
+    if (mf->data == NULL)
+        return (ZPOS64_T)ftello(mf->file);
+    return mf->pos;
+}
+
+static long ZCALLBACK mmap_seek64_file_func(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin) {
+    MMAP_FILE* mf = (MMAP_FILE*)stream;
+    int fseek_origin = 0;
+    ZPOS64_T base;
+    (void)opaque;
+
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        fseek_origin = SEEK_CUR;
+        base = mf->pos;
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        fseek_origin = SEEK_END;
+        base = mf->size;
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        fseek_origin = SEEK_SET;
+        base = 0;
+        break;
+    default: return -1;
+    }
+
+    if (mf->data == NULL)
+        return (fseeko(mf->file, (off_t)offset, fseek_origin) != 0) ? -1 : 0;
+
+    if (offset > mf->size - base)
+        return -1;
+    mf->pos = base + offset;
+    return 0;
+}
+
+static int ZCALLBACK mmap_close_file_func(voidpf opaque, voidpf stream) {
+    MMAP_FILE* mf = (MMAP_FILE*)stream;
+    int ret = 0;
+
+    if (opaque != NULL) {
+        ((mmap_file_view*)opaque)->data = NULL;
+        ((mmap_file_view*)opaque)->size = 0;
+    }
+
+    if (mf->data != NULL)
+        ret = munmap((void*)mf->data, (size_t)mf->size);
+    else
+        ret = fclose(mf->file);
+    free(mf);
+    return ret;
+}
+
+static int ZCALLBACK mmap_error_file_func(voidpf opaque, voidpf stream) {
+    MMAP_FILE* mf = (MMAP_FILE*)stream;
+    (void)opaque;
+
+    if (mf->data == NULL)
+        return ferror(mf->file);
+    return 0;
+}
+
+void fill_mmap_filefunc64(zlib_filefunc64_def* pzlib_filefunc_def) {
+    pzlib_filefunc_def->zopen64_file = mmap_open64_file_func;
+    pzlib_filefunc_def->zread_file = mmap_read_file_func;
+    pzlib_filefunc_def->zwrite_file = mmap_write_file_func;
+    pzlib_filefunc_def->ztell64_file = mmap_tell64_file_func;
+    pzlib_filefunc_def->zseek64_file = mmap_seek64_file_func;
+    pzlib_filefunc_def->zclose_file = mmap_close_file_func;
+    pzlib_filefunc_def->zerror_file = mmap_error_file_func;
+    pzlib_filefunc_def->opaque = NULL;
+}
@@ -0,0 +1,31 @@
+/* iommap.h -- IO base function header for compress/uncompress .zip
+   Reads the archive through a read-only memory mapping, so the data isn't
+   copied through a stdio buffer first. Falls back to stdio when the file
+   can't be mapped.
+*/
+
+#ifndef _IOMMAP_H
+#define _IOMMAP_H
+
+#include "ioapi.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* If opaque points to one of these, the open function fills in the mapping
+   so callers can read stored entries in place (data is NULL for the stdio
+   fallback). It is reset when the file is closed. */
+typedef struct
+{
+    const unsigned char* data;
+    ZPOS64_T size;
+} mmap_file_view;
+
+void fill_mmap_filefunc64(zlib_filefunc64_def* pzlib_filefunc_def);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+#include "archive_index.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+// Index file layout (native byte order, it never leaves the device):
+//   IndexHeader, archive path, then page_count records of
+//   IndexRecord followed by name_len bytes of filename
+#define INDEX_MAGIC 0x58495243  // "CRIX"
+#define INDEX_VERSION 2  // 1 could hold page tables cut off at 2000 pages
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t file_size;
+    int64_t file_mtime;
+    uint32_t format;
+    uint32_t page_count;
+    uint32_t path_len;
+} IndexHeader;
+
+typedef struct {
+    uint32_t compressed_size;
+    uint32_t uncompressed_size;
+    int64_t offset;
+    int64_t entry_index;
+    uint16_t name_len;
+} IndexRecord;
+
+// Index file name is a hash of the archive path (FNV-1a)
+static void index_path_for(const char *filepath, char *out, size_t out_len) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = filepath; *p; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    snprintf(out, out_len, "%s/%016llx.idx", ARCHIVE_INDEX_DIR, (unsigned long long)hash);
+}
+
+int archive_index_load(ComicBook *comic) {
+    struct stat st;
+    if (stat(comic->filepath, &st) != 0) {
+        return -1;
+    }
+
+    char index_path[512];
+    index_path_for(comic->filepath, index_path, sizeof(index_path));
+
+    FILE *f = fopen(index_path, "rb");
+    if (!f) {
+        return -1;
+    }
+
+    IndexHeader header;
+    char path[sizeof(comic->filepath)];
+    size_t path_len = strlen(comic->filepath);
+
+    // Archive must be unchanged since the index was written
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != INDEX_MAGIC ||
+        header.version != INDEX_VERSION ||
+        header.file_size != (uint64_t)st.st_size ||
+        header.file_mtime != (int64_t)st.st_mtime ||
+        header.format != (uint32_t)comic->format ||
+        header.page_count == 0 ||
+        header.path_len != path_len ||
+        fread(path, 1, path_len, f) != path_len ||
+        memcmp(path, comic->filepath, path_len) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < header.page_count; i++) {
+        IndexRecord rec;
+        char name[MAX_FILENAME];
+        PageInfo *page;
+
+        // Caller drops the partly loaded table on failure
+        if (fread(&rec, sizeof(rec), 1, f) != 1 ||
+            rec.name_len == 0 || rec.name_len >= MAX_FILENAME ||
+            fread(name, 1, rec.name_len, f) != rec.name_len ||
+            !(page = comic_add_page(comic, name, rec.name_len))) {
+            fclose(f);
+            return -1;
+        }
+
+        page->compressed_size = rec.compressed_size;
+        page->uncompressed_size = rec.uncompressed_size;
+        page->offset = rec.offset;
+        page->entry_index = rec.entry_index;
+    }
+
+    fclose(f);
+
+    printf("Loaded page index: %s\n", index_path);
+    return 0;
+}
+
+int archive_index_save(const ComicBook *comic) {
+    struct stat st;
+    if (comic->page_count <= 0 || stat(comic->filepath, &st) != 0) {
+        return -1;
+    }
+
+    mkdir("/media/internal/.comic-reader", 0755);
+    mkdir(ARCHIVE_INDEX_DIR, 0755);
+
+    char index_path[512];
+    char tmp_path[520];
+    index_path_for(comic->filepath, index_path, sizeof(index_path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", index_path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Failed to write page index: %s\n", tmp_path);
+        return -1;
+    }
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.file_size = st.st_size;
+    header.file_mtime = st.st_mtime;
+    header.format = comic->format;
+    header.page_count = comic->page_count;
+    header.path_len = strlen(comic->filepath);
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+             fwrite(comic->filepath, 1, header.path_len, f) == header.path_len;
+
+    for (int i = 0; ok && i < comic->page_count; i++) {
+        const PageInfo *page = &comic->pages[i];
+        IndexRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.compressed_size = page->compressed_size;
+        rec.uncompressed_size = page->uncompressed_size;
+        rec.offset = page->offset;
+        rec.entry_index = page->entry_index;
+        size_t name_len = strlen(page->filename);
+        if (name_len >= MAX_FILENAME) {
+            // Wouldn't load back; leave the comic unindexed rather than
+            // write an index short of pages
+            ok = 0;
+            break;
+        }
+        rec.name_len = (uint16_t)name_len;
+
+        ok = fwrite(&rec, sizeof(rec), 1, f) == 1 &&
+             fwrite(page->filename, 1, rec.name_len, f) == rec.name_len;
+    }
+
+    if (fclose(f) != 0) ok = 0;
+
+    // Rename into place so a crash never leaves a half-written index
+    if (!ok || rename(tmp_path, index_path) != 0) {
+        fprintf(stderr, "Failed to write page index: %s\n", index_path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
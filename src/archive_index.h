@@ -0,0 +1,19 @@
+#ifndef ARCHIVE_INDEX_H
+#define ARCHIVE_INDEX_H
+
+#include "cbz.h"
+
+// Where page tables of previously opened comics are kept
+#define ARCHIVE_INDEX_DIR "/media/internal/.comic-reader/index"
+
+// Load the sorted page table for comic->filepath from the index cache.
+// Only succeeds if the archive's size and mtime still match.
+// Returns 0 on success, -1 if there is no usable index (pages may have been
+// added to comic's page table already).
+int archive_index_load(ComicBook *comic);
+
+// Save the (already sorted) page table of comic to the index cache
+// Returns 0 on success, -1 on failure
+int archive_index_save(const ComicBook *comic);
+
+#endif
@@ -0,0 +1,53 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+void *arena_alloc(StringArena *arena, size_t size) {
+    ArenaBlock *block = arena->head;
+
+    if (!block || block->size - block->used < size) {
+        // Oversized requests get a block of their own
+        size_t block_size = (size > ARENA_BLOCK_SIZE) ? size : ARENA_BLOCK_SIZE;
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + block_size);
+        if (!block) {
+            return NULL;
+        }
+        block->next = arena->head;
+        block->used = 0;
+        block->size = block_size;
+        arena->head = block;
+    }
+
+    void *ptr = block->data + block->used;
+    block->used += size;
+    arena->used += size;
+    return ptr;
+}
+
+const char *arena_strndup(StringArena *arena, const char *str, size_t len) {
+    char *copy = (char *)arena_alloc(arena, len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+void arena_free(StringArena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->used = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+// Append-only string storage. Memory comes in blocks that never move, so
+// pointers handed out stay valid until the arena is freed.
+#define ARENA_BLOCK_SIZE (16 * 1024)
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;       // Block currently filled, older ones follow
+    size_t used;            // Bytes handed out in total
+} StringArena;
+
+// Allocate size bytes, NULL if out of memory
+void *arena_alloc(StringArena *arena, size_t size);
+
+// Copy len bytes of str plus a terminating NUL, NULL if out of memory
+const char *arena_strndup(StringArena *arena, const char *str, size_t len);
+
+// Free all blocks (the arena can be used again afterwards)
+void arena_free(StringArena *arena);
+
+#endif
@@ -1,125 +1,193 @@
 #include "cache.h"
+#include "jpeg_decode.h"
+#include "png_decode.h"
+#include "scale.h"
 #include <SDL_image.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-void cache_init(PageCache *cache, ComicBook *comic) {
+static int decode_worker(void *data);
+
+// Largest channel difference of a page still taken for black and white
+// (JPEG chroma noise on scanned pages stays below it)
+#define GRAY_TOLERANCE 12
+
+void cache_init(PageCache *cache, ComicBook *comic, size_t budget, long long disk_budget) {
     memset(cache, 0, sizeof(PageCache));
     cache->comic = comic;
     cache->access_counter = 0;
-
-    for (int i = 0; i < CACHE_SIZE; i++) {
+    cache->budget = budget;
+    cache->current_page = -1;
+    cache->last_page = -1;
+    cache->direction = 1;
+    cache->failed_page = -1;
+    cache->tiles_failed = -1;
+    cache->tiled.page_index = -1;
+
+    SDL_Surface *screen = SDL_GetVideoSurface();
+    cache->rgb565 = screen && screen->format->BitsPerPixel == 16;
+
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
         cache->entries[i].page_index = -1;
         cache->entries[i].surface = NULL;
         cache->entries[i].last_used = 0;
     }
+
+    disk_cache_open(&cache->disk, comic->filepath, disk_budget);
+
+    cache->lock = SDL_CreateMutex();
+    cache->wake = SDL_CreateCond();
+    for (int i = 0; cache->lock && cache->wake && i < CACHE_WORKERS; i++) {
+        DecodeWorker *worker = &cache->workers[cache->worker_count];
+        worker->cache = cache;
+        worker->decoding = -1;
+        tile_decoder_init(&worker->tiler);
+        worker->thread = SDL_CreateThread(decode_worker, worker);
+        if (!worker->thread) {
+            break;
+        }
+        cache->worker_count++;
+    }
+    if (cache->worker_count == 0) {
+        fprintf(stderr, "Failed to start decode worker, decoding inline\n");
+    }
+}
+
+// Free every level of a cached page
+static void free_entry(CacheEntry *entry) {
+    if (entry->surface) SDL_FreeSurface(entry->surface);
+    entry->surface = NULL;
+    for (int i = 0; i < CACHE_FIT_LEVELS; i++) {
+        if (entry->fit[i].surface) SDL_FreeSurface(entry->fit[i].surface);
+        entry->fit[i].surface = NULL;
+    }
 }
 
 void cache_clear(PageCache *cache) {
-    for (int i = 0; i < CACHE_SIZE; i++) {
-        if (cache->entries[i].surface) {
-            SDL_FreeSurface(cache->entries[i].surface);
-            cache->entries[i].surface = NULL;
-        }
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        free_entry(&cache->entries[i]);
         cache->entries[i].page_index = -1;
         cache->entries[i].last_used = 0;
     }
+    cache->last_page = -1;
+    cache->failed_page = -1;
+    cache->tiles_failed = -1;
+    tiles_free(&cache->tiled);
 }
 
-// Scale surface to fit within max dimensions while maintaining aspect ratio
-static SDL_Surface *scale_surface(SDL_Surface *src, int max_width, int max_height) {
-    if (!src) return NULL;
-
-    int src_w = src->w;
-    int src_h = src->h;
-
-    // Calculate scale factor to fit within bounds
-    float scale_x = (float)max_width / src_w;
-    float scale_y = (float)max_height / src_h;
-    float scale = (scale_x < scale_y) ? scale_x : scale_y;
-
-    // Don't upscale small images
-    if (scale > 1.0f) scale = 1.0f;
-
-    int dst_w = (int)(src_w * scale);
-    int dst_h = (int)(src_h * scale);
-
-    // If no scaling needed, just copy
-    if (dst_w == src_w && dst_h == src_h) {
-        SDL_Surface *copy = SDL_ConvertSurface(src, src->format, src->flags);
-        return copy;
+void cache_destroy(PageCache *cache) {
+    if (cache->worker_count > 0) {
+        SDL_mutexP(cache->lock);
+        cache->quit = 1;
+        cache->queue_count = 0;
+        SDL_CondBroadcast(cache->wake);
+        SDL_mutexV(cache->lock);
+        for (int i = 0; i < cache->worker_count; i++) {
+            SDL_WaitThread(cache->workers[i].thread, NULL);
+            cache->workers[i].thread = NULL;
+        }
+        cache->worker_count = 0;
     }
 
-    // Create destination surface
-    SDL_Surface *dst = SDL_CreateRGBSurface(
-        SDL_SWSURFACE, dst_w, dst_h,
-        src->format->BitsPerPixel,
-        src->format->Rmask,
-        src->format->Gmask,
-        src->format->Bmask,
-        src->format->Amask
-    );
-
-    if (!dst) {
-        fprintf(stderr, "Failed to create scaled surface\n");
-        return NULL;
+    // Drop pages and tiles the main thread never picked up
+    for (int i = 0; i < cache->done_count; i++) {
+        if (cache->done[i].surface) {
+            SDL_FreeSurface(cache->done[i].surface);
+        }
+        if (cache->done[i].fit) {
+            SDL_FreeSurface(cache->done[i].fit);
+        }
+        if (cache->done[i].tiles) {
+            tiles_free_job(cache->done[i].tiles);
+            free(cache->done[i].tiles);
+        }
     }
+    cache->done_count = 0;
+    free(cache->tile_request);
+    cache->tile_request = NULL;
 
-    // Simple bilinear scaling
-    SDL_LockSurface(src);
-    SDL_LockSurface(dst);
-
-    Uint8 *src_pixels = (Uint8 *)src->pixels;
-    Uint8 *dst_pixels = (Uint8 *)dst->pixels;
-    int src_pitch = src->pitch;
-    int dst_pitch = dst->pitch;
-    int bpp = src->format->BytesPerPixel;
-
-    for (int y = 0; y < dst_h; y++) {
-        float src_y = y / scale;
-        int src_y_int = (int)src_y;
-        if (src_y_int >= src_h - 1) src_y_int = src_h - 2;
-
-        for (int x = 0; x < dst_w; x++) {
-            float src_x = x / scale;
-            int src_x_int = (int)src_x;
-            if (src_x_int >= src_w - 1) src_x_int = src_w - 2;
+    if (cache->wake) {
+        SDL_DestroyCond(cache->wake);
+        cache->wake = NULL;
+    }
+    if (cache->lock) {
+        SDL_DestroyMutex(cache->lock);
+        cache->lock = NULL;
+    }
 
-            // Simple nearest neighbor for speed
-            Uint8 *src_pixel = src_pixels + src_y_int * src_pitch + src_x_int * bpp;
-            Uint8 *dst_pixel = dst_pixels + y * dst_pitch + x * bpp;
+    cache_clear(cache);
+    disk_cache_close(&cache->disk);
+}
 
-            memcpy(dst_pixel, src_pixel, bpp);
-        }
+// Black and white pages are kept in 8-bit grayscale. Pages for a 16-bit
+// screen are dithered on the worker; SDL_DisplayFormat would only truncate
+// them on the main thread.
+static SDL_Surface *to_cache_format(PageCache *cache, SDL_Surface *surface) {
+    if (is_gray_format(surface->format)) {
+        return surface;
     }
 
-    SDL_UnlockSurface(dst);
-    SDL_UnlockSurface(src);
+    SDL_Surface *converted = NULL;
+    if (surface_is_gray(surface, GRAY_TOLERANCE)) {
+        converted = surface_to_gray(surface);
+    } else if (cache->rgb565 && surface->format->BytesPerPixel != 2) {
+        converted = surface_to_rgb565(surface);
+    }
 
-    return dst;
+    if (!converted) {
+        return surface;
+    }
+    SDL_FreeSurface(surface);
+    return converted;
 }
 
-// Load and scale a page
-static SDL_Surface *load_page(PageCache *cache, int page_index) {
-    size_t data_size;
-    unsigned char *data = cbz_extract_page(cache->comic, page_index, &data_size);
+// Load a page scaled to fit max_width x max_height. *image_w/*image_h are
+// set to the page image's full size if it can be tiled, 0 otherwise.
+static SDL_Surface *load_page(PageCache *cache, int page_index, int max_width, int max_height,
+                              int *image_w, int *image_h) {
+    *image_w = 0;
+    *image_h = 0;
+
+    // Pages are stored in their cache format. One stored for the other
+    // screen depth is decoded again (and stored over).
+    SDL_Surface *stored = disk_cache_get(&cache->disk, page_index, max_width, max_height,
+                                         image_w, image_h);
+    if (stored && !is_gray_format(stored->format) &&
+        (stored->format->BytesPerPixel == 2) != cache->rgb565) {
+        SDL_FreeSurface(stored);
+        stored = NULL;
+    }
+    if (stored) {
+        printf("Loaded page %d from disk cache: %dx%d\n", page_index, stored->w, stored->h);
+        return stored;
+    }
 
-    if (!data) {
+    // Decode straight from the archive: stored CBZ pages are read from the
+    // mapping, compressed ones are inflated as the decoder asks for bytes
+    SDL_RWops *rw = comic_open_page_rw(cache->comic, page_index);
+    if (!rw) {
         fprintf(stderr, "Failed to extract page %d\n", page_index);
         return NULL;
     }
 
-    // Load image from memory
-    SDL_RWops *rw = SDL_RWFromMem(data, data_size);
-    if (!rw) {
-        fprintf(stderr, "Failed to create RWops for page %d\n", page_index);
-        free(data);
-        return NULL;
+    // JPEGs are decoded at a reduced IDCT scale close to the cache size and
+    // PNGs are downscaled row by row, so neither exists at full resolution
+    SDL_Surface *original = NULL;
+    if (jpeg_sniff(rw)) {
+        original = jpeg_load_scaled(rw, max_width, max_height, image_w, image_h);
+    } else if (png_sniff(rw)) {
+        original = png_load_scaled(rw, max_width, max_height, image_w, image_h);
     }
 
-    SDL_Surface *original = IMG_Load_RW(rw, 1); // 1 = auto-close RWops
-    free(data); // Free compressed data, no longer needed
+    if (original) {
+        SDL_RWclose(rw);
+    } else {
+        *image_w = 0;
+        *image_h = 0;
+        SDL_RWseek(rw, 0, RW_SEEK_SET);
+        original = IMG_Load_RW(rw, 1); // 1 = auto-close RWops
+    }
 
     if (!original) {
         fprintf(stderr, "Failed to decode image for page %d: %s\n", page_index, IMG_GetError());
@@ -129,8 +197,11 @@ static SDL_Surface *load_page(PageCache *cache, int page_index) {
     printf("Loaded page %d: %dx%d\n", page_index, original->w, original->h);
 
     // Scale to cache size (larger than screen for zoom quality)
-    SDL_Surface *scaled = scale_surface(original, CACHE_WIDTH, CACHE_HEIGHT);
-    SDL_FreeSurface(original); // Free original, keep only scaled
+    SDL_Surface *scaled = original;
+    if (original->w > max_width || original->h > max_height) {
+        scaled = scale_surface(original, max_width, max_height);
+        SDL_FreeSurface(original); // Free original, keep only scaled
+    }
 
     if (!scaled) {
         return NULL;
@@ -138,83 +209,801 @@ static SDL_Surface *load_page(PageCache *cache, int page_index) {
 
     printf("Scaled page %d to %dx%d\n", page_index, scaled->w, scaled->h);
 
-    // Convert to display format for proper colors
-    SDL_Surface *display = SDL_DisplayFormat(scaled);
-    SDL_FreeSurface(scaled);
+    SDL_Surface *page = to_cache_format(cache, scaled);
+    disk_cache_put(&cache->disk, page_index, max_width, max_height, page, *image_w, *image_h);
+    return page;
+}
 
-    if (!display) {
-        fprintf(stderr, "Failed to convert to display format\n");
-        return scaled; // Fall back to unconverted
+// Number of workers currently decoding (call with lock held)
+static int busy_workers(PageCache *cache) {
+    int busy = 0;
+    for (int i = 0; i < cache->worker_count; i++) {
+        if (cache->workers[i].decoding >= 0) busy++;
     }
+    return busy;
+}
 
-    return display;
+// Check whether pages are queued or being decoded (call with lock held)
+static int pages_wanted(PageCache *cache) {
+    for (int i = 0; i < cache->worker_count; i++) {
+        if (cache->workers[i].decoding >= 0 && !cache->workers[i].tiles) return 1;
+    }
+    return cache->queue_count > 0;
 }
 
-// Find LRU entry to evict
-static int find_lru_entry(PageCache *cache) {
-    int oldest_idx = 0;
-    unsigned int oldest_time = cache->entries[0].last_used;
+// Runs on a worker thread: decode queued pages until told to quit
+static int decode_worker(void *data) {
+    DecodeWorker *worker = (DecodeWorker *)data;
+    PageCache *cache = worker->cache;
+
+    SDL_mutexP(cache->lock);
+    while (!cache->quit) {
+        // A page kept open for tiles can hold one of the comic's few archive
+        // handles, so it's let go while pages need them
+        if (worker->tiler.page_index >= 0 && pages_wanted(cache)) {
+            SDL_mutexV(cache->lock);
+            tile_decoder_close(&worker->tiler);
+            SDL_mutexP(cache->lock);
+            continue;
+        }
+
+        // Wait for work, and for room to hand the result back once every
+        // busy worker has finished too
+        if ((cache->queue_count == 0 && !cache->tile_request) ||
+            cache->done_count + busy_workers(cache) >= CACHE_QUEUE_SIZE) {
+            SDL_CondWait(cache->wake, cache->lock);
+            continue;
+        }
 
-    for (int i = 1; i < CACHE_SIZE; i++) {
-        // Prefer empty slots
+        // Pages first, tiles when nothing else is queued
+        DecodedPage result;
+        memset(&result, 0, sizeof(result));
+        if (cache->queue_count > 0) {
+            result.page_index = cache->queue[0];
+            result.fit_view_w = cache->view_w;
+            result.fit_view_h = cache->view_h;
+            cache->queue_count--;
+            memmove(&cache->queue[0], &cache->queue[1], cache->queue_count * sizeof(int));
+
+            // Workers idle with a page open for tiles close it
+            SDL_CondBroadcast(cache->wake);
+        } else {
+            result.tiles = cache->tile_request;
+            result.page_index = result.tiles->page_index;
+            cache->tile_request = NULL;
+        }
+        worker->decoding = result.page_index;
+        worker->tiles = result.tiles != NULL;
+        SDL_mutexV(cache->lock);
+
+        if (result.tiles) {
+            // Panning down carries on from the last job, only panning up
+            // (or another page or zoom) starts the page over
+            if (!tile_decoder_continues(&worker->tiler, result.tiles)) {
+                tile_decoder_close(&worker->tiler);
+                SDL_RWops *rw = comic_open_page_rw(cache->comic, result.page_index);
+                if (rw) {
+                    tile_decoder_open(&worker->tiler, result.tiles, rw);
+                }
+            }
+            tiles_decode(&worker->tiler, result.tiles);
+        } else {
+            Uint32 start = SDL_GetTicks();
+            result.surface = load_page(cache, result.page_index, CACHE_WIDTH, CACHE_HEIGHT,
+                                       &result.image_w, &result.image_h);
+
+            // Fit level for the view being drawn, so the page's first
+            // unzoomed frame is a plain blit too
+            SDL_Surface *page = result.surface;
+            if (page && result.fit_view_w > 0 &&
+                (page->w > result.fit_view_w || page->h > result.fit_view_h)) {
+                result.fit = scale_surface(page, result.fit_view_w, result.fit_view_h);
+            }
+            result.decode_ms = SDL_GetTicks() - start;
+        }
+
+        SDL_mutexP(cache->lock);
+        worker->decoding = -1;
+        worker->tiles = 0;
+        cache->done[cache->done_count++] = result;
+        SDL_mutexV(cache->lock);
+
+        // Wake the main loop so it picks the page up
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = SDL_USEREVENT;
+        event.user.code = CACHE_EVENT_PAGE_READY;
+        SDL_PushEvent(&event);
+
+        SDL_mutexP(cache->lock);
+    }
+    SDL_mutexV(cache->lock);
+
+    tile_decoder_close(&worker->tiler);
+    return 0;
+}
+
+// Bytes held by a cached page's levels
+static size_t entry_bytes(CacheEntry *entry) {
+    size_t bytes = 0;
+    if (entry->surface) bytes += (size_t)entry->surface->pitch * entry->surface->h;
+    for (int i = 0; i < CACHE_FIT_LEVELS; i++) {
+        SDL_Surface *fit = entry->fit[i].surface;
+        if (fit) bytes += (size_t)fit->pitch * fit->h;
+    }
+    return bytes;
+}
+
+// Bytes held by the tiled level. Tiles being decoded count at full tile
+// size already, so the pages making room for them go before they arrive.
+static size_t tiled_bytes(PageCache *cache) {
+    TiledPage *tiled = &cache->tiled;
+    size_t pending = (size_t)TILE_SIZE * TILE_SIZE * (tiled->gray ? 1 : cache->rgb565 ? 2 : 4);
+    size_t bytes = 0;
+    for (int i = 0; tiled->tiles && i < tiled->cols * tiled->rows; i++) {
+        Tile *tile = &tiled->tiles[i];
+        if (tile->surface) {
+            bytes += (size_t)tile->surface->pitch * tile->surface->h;
+        } else if (tile->pending) {
+            bytes += pending;
+        }
+    }
+    return bytes;
+}
+
+// Bytes held by all cached pages and the tiled level
+static size_t cache_bytes(PageCache *cache) {
+    size_t bytes = tiled_bytes(cache);
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        bytes += entry_bytes(&cache->entries[i]);
+    }
+    return bytes;
+}
+
+// How much a page is wanted, lower first: the current page, the prefetch
+// window in order, then further in the reading direction, and further back
+// last. Eviction goes by this the other way.
+static int page_rank(PageCache *cache, int page_index) {
+    if (page_index == cache->current_page) {
+        return 0;
+    }
+    for (int i = 0; i < cache->window_count; i++) {
+        if (cache->window[i] == page_index) {
+            return i + 1;
+        }
+    }
+
+    int d = (page_index - cache->current_page) * cache->direction;
+    return (d > 0) ? cache->window_count + d : cache->window_count + cache->comic->page_count - d;
+}
+
+// Find an unused slot, or -1
+static int find_free_entry(PageCache *cache) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
         if (cache->entries[i].page_index < 0) {
             return i;
         }
-        if (cache->entries[i].last_used < oldest_time) {
-            oldest_time = cache->entries[i].last_used;
-            oldest_idx = i;
+    }
+    return -1;
+}
+
+// Find the entry to evict: the least wanted by page_rank, least recently
+// used among equals. The current page and the last ready one (drawn as a
+// placeholder) are never picked; -1 if nothing else.
+static int find_victim(PageCache *cache) {
+    int victim = -1;
+
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        CacheEntry *entry = &cache->entries[i];
+        if (entry->page_index < 0 || entry->page_index == cache->current_page ||
+            entry->page_index == cache->last_page) {
+            continue;
+        }
+        if (victim < 0) {
+            victim = i;
+            continue;
+        }
+
+        int rank = page_rank(cache, entry->page_index);
+        int victim_rank = page_rank(cache, cache->entries[victim].page_index);
+        if (rank > victim_rank ||
+            (rank == victim_rank && entry->last_used < cache->entries[victim].last_used)) {
+            victim = i;
         }
     }
 
-    return oldest_idx;
+    return victim;
 }
 
-SDL_Surface *cache_get_page(PageCache *cache, int page_index) {
-    if (page_index < 0 || page_index >= cache->comic->page_count) {
-        return NULL;
+static void evict_entry(PageCache *cache, int slot) {
+    printf("Evicting page %d from cache\n", cache->entries[slot].page_index);
+    if (cache->tiled.page_index == cache->entries[slot].page_index) {
+        tiles_free(&cache->tiled);
     }
+    free_entry(&cache->entries[slot]);
+    cache->entries[slot].page_index = -1;
+}
 
-    cache->access_counter++;
+// Evict the least wanted pages until the cache is back within budget
+static void trim_cache(PageCache *cache) {
+    while (cache_bytes(cache) > cache->budget) {
+        int victim = find_victim(cache);
+        if (victim < 0) {
+            break;
+        }
+        evict_entry(cache, victim);
+    }
+}
 
-    // Check if already cached
-    for (int i = 0; i < CACHE_SIZE; i++) {
+// Find the slot holding a page, or -1
+static int find_entry(PageCache *cache, int page_index) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
         if (cache->entries[i].page_index == page_index) {
-            cache->entries[i].last_used = cache->access_counter;
-            return cache->entries[i].surface;
+            return i;
         }
     }
+    return -1;
+}
 
-    // Not cached, need to load
-    SDL_Surface *surface = load_page(cache, page_index);
-    if (!surface) {
-        return NULL;
+// Convert to display format for proper colors (main thread only). Returns
+// surface itself if it's in that format already (RGB565 pages on a 16-bit
+// screen) or grayscale, NULL on failure.
+static SDL_Surface *to_display_format(SDL_Surface *surface) {
+    SDL_PixelFormat *screen = SDL_GetVideoSurface()->format;
+    SDL_PixelFormat *format = surface->format;
+    if (is_gray_format(format)) {
+        return surface;  // Expanded to the screen format as it's drawn
+    }
+    if (format->BitsPerPixel == screen->BitsPerPixel && !format->palette &&
+        format->Rmask == screen->Rmask && format->Gmask == screen->Gmask &&
+        format->Bmask == screen->Bmask) {
+        return surface;
+    }
+    return SDL_DisplayFormat(surface);
+}
+
+// Store a decoded page, evicting less wanted pages until it fits the
+// budget. If the rest are all wanted more, a page outside the prefetch
+// window (flipped past already) is dropped; one inside is kept even if
+// that leaves the cache over budget for a while: the window is sized by
+// the budget, so that's only a mis-estimate, and dropping it would have it
+// decoded again.
+static void store_page(PageCache *cache, DecodedPage *page) {
+    SDL_Surface *surface = page->surface;
+
+    SDL_Surface *display = to_display_format(surface);
+    if (display && display != surface) {
+        SDL_FreeSurface(surface);
+        surface = display;
+    } else if (!display) {
+        fprintf(stderr, "Failed to convert to display format\n");
+        // Fall back to unconverted
     }
 
-    // Find slot (empty or LRU)
-    int slot = find_lru_entry(cache);
+    // A fit level that can't be converted is made again when drawn
+    SDL_Surface *fit = page->fit ? to_display_format(page->fit) : NULL;
+    if (page->fit && fit != page->fit) {
+        SDL_FreeSurface(page->fit);
+    }
+    page->fit = NULL;
 
-    // Evict old entry if needed
-    if (cache->entries[slot].surface) {
-        printf("Evicting page %d from cache\n", cache->entries[slot].page_index);
-        SDL_FreeSurface(cache->entries[slot].surface);
+    int slot = find_entry(cache, page->page_index);
+    if (slot >= 0) {
+        free_entry(&cache->entries[slot]);
+        cache->entries[slot].page_index = -1;
+    }
+
+    size_t bytes = (size_t)surface->pitch * surface->h;
+    if (fit) bytes += (size_t)fit->pitch * fit->h;
+    for (;;) {
+        slot = find_free_entry(cache);
+        if (slot >= 0 && cache_bytes(cache) + bytes <= cache->budget) {
+            break;
+        }
+
+        int victim = find_victim(cache);
+        int rank = page_rank(cache, page->page_index);
+        if (victim >= 0 && page_rank(cache, cache->entries[victim].page_index) > rank) {
+            evict_entry(cache, victim);
+            continue;
+        }
+        if (rank > cache->window_count) {
+            printf("Dropping page %d, no longer wanted\n", page->page_index);
+            SDL_FreeSurface(surface);
+            if (fit) SDL_FreeSurface(fit);
+            return;
+        }
+        if (slot >= 0 || victim < 0) {
+            break;
+        }
+        evict_entry(cache, victim);
     }
 
     // Store new entry
-    cache->entries[slot].page_index = page_index;
+    cache->entries[slot].page_index = page->page_index;
     cache->entries[slot].surface = surface;
+    cache->entries[slot].image_w = page->image_w;
+    cache->entries[slot].image_h = page->image_h;
     cache->entries[slot].last_used = cache->access_counter;
+    cache->entries[slot].fit[0].surface = fit;
+    cache->entries[slot].fit[0].view_w = page->fit_view_w;
+    cache->entries[slot].fit[0].view_h = page->fit_view_h;
+    cache->entries[slot].fit[0].last_used = cache->access_counter;
+}
+
+// Hand a finished tile job's tiles to the tiled level, if it's still the
+// one they were decoded for
+static void store_tiles(PageCache *cache, TileJob *job) {
+    TiledPage *tiled = &cache->tiled;
+    int current = tiled->page_index == job->page_index &&
+                  tiled->width == job->width && tiled->height == job->height;
+
+    if (!job->tiles && current) {
+        fprintf(stderr, "Failed to load tiles of page %d\n", job->page_index);
+        cache->tiles_failed = job->page_index;
+    }
+
+    int i = 0;
+    for (int row = job->row0; row <= job->row1; row++) {
+        for (int col = job->col0; col <= job->col1; col++, i++) {
+            Tile *tile = current ? tiles_at(tiled, col, row) : NULL;
+            if (!tile) continue;
+
+            if (tile->pending == job->serial) tile->pending = 0;
+            if (!job->tiles || tile->surface) continue;
+
+            // Kept as is if already in display format, the job lets go of it
+            tile->surface = to_display_format(job->tiles[i]);
+            if (tile->surface == job->tiles[i]) {
+                job->tiles[i] = NULL;
+            } else if (!tile->surface) {
+                fprintf(stderr, "Failed to convert tile to display format\n");
+                cache->tiles_failed = job->page_index;
+            }
+        }
+    }
+
+    tiles_free_job(job);
+    free(job);
+}
+
+int cache_pump(PageCache *cache) {
+    DecodedPage done[CACHE_QUEUE_SIZE];
+    int count;
+
+    if (cache->worker_count == 0) {
+        return 0;
+    }
+
+    SDL_mutexP(cache->lock);
+    count = cache->done_count;
+    memcpy(done, cache->done, count * sizeof(DecodedPage));
+    cache->done_count = 0;
+    SDL_CondBroadcast(cache->wake);
+    SDL_mutexV(cache->lock);
+
+    int tiles = 0;
+    for (int i = 0; i < count; i++) {
+        if (done[i].tiles) {
+            store_tiles(cache, done[i].tiles);
+            tiles = 1;
+            continue;
+        }
+        if (!done[i].surface) {
+            fprintf(stderr, "Failed to load page %d\n", done[i].page_index);
+            cache->failed_page = done[i].page_index;
+            continue;
+        }
+        cache->decode_ms = cache->decode_ms ? (cache->decode_ms * 3 + done[i].decode_ms) / 4
+                                            : done[i].decode_ms;
+        store_page(cache, &done[i]);
+    }
+
+    // Tiles come out of the same budget as pages
+    if (tiles) {
+        trim_cache(cache);
+    }
+
+    return count;
+}
+
+void cache_request_page(PageCache *cache, int page_index, int urgent) {
+    if (page_index < 0 || page_index >= cache->comic->page_count) {
+        return;
+    }
+    if (find_entry(cache, page_index) >= 0 || page_index == cache->failed_page) {
+        return;
+    }
+
+    // No worker: decode synchronously like before
+    if (cache->worker_count == 0) {
+        DecodedPage page;
+        memset(&page, 0, sizeof(page));
+        page.page_index = page_index;
+        page.surface = load_page(cache, page_index, CACHE_WIDTH, CACHE_HEIGHT,
+                                 &page.image_w, &page.image_h);
+        if (page.surface) {
+            store_page(cache, &page);
+        } else {
+            cache->failed_page = page_index;
+        }
+        return;
+    }
+
+    SDL_mutexP(cache->lock);
+
+    int queued = -1;
+    for (int i = 0; i < cache->queue_count; i++) {
+        if (cache->queue[i] == page_index) {
+            queued = i;
+            break;
+        }
+    }
+
+    // Already in progress or finished but not yet pumped
+    int in_flight = 0;
+    for (int i = 0; i < cache->worker_count; i++) {
+        if (cache->workers[i].decoding == page_index && !cache->workers[i].tiles) in_flight = 1;
+    }
+    for (int i = 0; i < cache->done_count; i++) {
+        if (cache->done[i].page_index == page_index && !cache->done[i].tiles) in_flight = 1;
+    }
+
+    if (!in_flight) {
+        if (queued >= 0 && urgent) {
+            // Move to the front
+            memmove(&cache->queue[1], &cache->queue[0], queued * sizeof(int));
+            cache->queue[0] = page_index;
+        } else if (queued < 0) {
+            if (urgent) {
+                // Push to the front, dropping the oldest prefetch if full
+                int keep = cache->queue_count;
+                if (keep >= CACHE_QUEUE_SIZE) keep = CACHE_QUEUE_SIZE - 1;
+                memmove(&cache->queue[1], &cache->queue[0], keep * sizeof(int));
+                cache->queue[0] = page_index;
+                cache->queue_count = keep + 1;
+            } else if (cache->queue_count < CACHE_QUEUE_SIZE) {
+                cache->queue[cache->queue_count++] = page_index;
+            }
+        }
+        SDL_CondSignal(cache->wake);
+    }
 
-    return surface;
+    SDL_mutexV(cache->lock);
+}
+
+SDL_Surface *cache_get_page(PageCache *cache, int page_index, int *ready) {
+    *ready = 0;
+    if (page_index < 0 || page_index >= cache->comic->page_count) {
+        return NULL;
+    }
+
+    cache->access_counter++;
+
+    // Page turn: learn the reading direction (two turns the same way in a
+    // row, so a look back doesn't flip it) and how long pages take to read
+    if (page_index != cache->current_page) {
+        Uint32 now = SDL_GetTicks();
+        if (cache->current_page >= 0) {
+            int step = (page_index > cache->current_page) ? 1 : -1;
+            cache->step_streak = (step == cache->last_step) ? cache->step_streak + 1 : 1;
+            cache->last_step = step;
+            if (cache->step_streak >= 2) {
+                cache->direction = step;
+            }
+
+            // Jumps (e.g. from the page slider) aren't reading
+            if (page_index - cache->current_page == step) {
+                Uint32 spent = now - cache->page_shown_at;
+                cache->page_ms = cache->page_ms ? (cache->page_ms * 3 + spent) / 4 : spent;
+            }
+        }
+        cache->current_page = page_index;
+        cache->page_shown_at = now;
+    }
+
+    // Check if already cached
+    int slot = find_entry(cache, page_index);
+    if (slot < 0) {
+        // Not cached, queue it ahead of any prefetches
+        cache_request_page(cache, page_index, 1);
+        slot = find_entry(cache, page_index);
+    }
+
+    if (slot >= 0) {
+        cache->entries[slot].last_used = cache->access_counter;
+        cache->last_page = page_index;
+        *ready = 1;
+        return cache->entries[slot].surface;
+    }
+
+    if (page_index == cache->failed_page) {
+        *ready = 1;
+        return NULL;
+    }
+
+    // Still decoding: hand out the last good page as a placeholder
+    slot = find_entry(cache, cache->last_page);
+    if (slot >= 0) {
+        cache->entries[slot].last_used = cache->access_counter;
+        return cache->entries[slot].surface;
+    }
+
+    return NULL;
 }
 
 void cache_preload_adjacent(PageCache *cache, int current_page) {
-    // Preload next page
-    if (current_page + 1 < cache->comic->page_count) {
-        cache_get_page(cache, current_page + 1);
+    // Pages the reader gets through while one decodes, plus one to spare
+    int ahead = CACHE_MIN_AHEAD;
+    if (cache->page_ms > 0 && cache->decode_ms > 0) {
+        int more = 1 + (cache->decode_ms + cache->page_ms - 1) / cache->page_ms;
+        if (more > ahead) ahead = more;
+    }
+    if (ahead > CACHE_MAX_ENTRIES - 2) ahead = CACHE_MAX_ENTRIES - 2;
+
+    // Pages not decoded yet are guessed to be as big as the biggest one
+    // cached (comics rarely change page size), or a full cache-size page
+    size_t guess = 0;
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        size_t bytes = entry_bytes(&cache->entries[i]);
+        if (bytes > guess) guess = bytes;
     }
+    if (guess == 0) {
+        guess = (size_t)CACHE_WIDTH * CACHE_HEIGHT * (cache->rgb565 ? 2 : 4);
+    }
+
+    // The zoomed page's tiles leave less room for the window
+    int slot = find_entry(cache, current_page);
+    size_t used = (slot >= 0) ? entry_bytes(&cache->entries[slot]) : guess;
+    used += tiled_bytes(cache);
+
+    // Window: pages ahead, then the one behind, while they fit the budget
+    cache->window_count = 0;
+    for (int n = 1; n <= ahead + 1; n++) {
+        int page_index = (n <= ahead) ? current_page + n * cache->direction
+                                      : current_page - cache->direction;
+        if (page_index < 0 || page_index >= cache->comic->page_count) {
+            continue;
+        }
+
+        slot = find_entry(cache, page_index);
+        used += (slot >= 0) ? entry_bytes(&cache->entries[slot]) : guess;
+        if (used > cache->budget) {
+            break;
+        }
+        cache->window[cache->window_count++] = page_index;
+    }
+
+    // No worker: decode synchronously, just the most wanted page
+    if (cache->worker_count == 0) {
+        if (cache->window_count > 0) {
+            cache_request_page(cache, cache->window[0], 0);
+        }
+        return;
+    }
+
+    SDL_mutexP(cache->lock);
+
+    // Rebuild the queue: the current page if it's waiting, then the window
+    // in order. Anything else queued was flipped past, cancel it.
+    int queue[CACHE_QUEUE_SIZE];
+    int count = 0;
+    for (int i = 0; i < cache->queue_count; i++) {
+        if (cache->queue[i] == current_page) {
+            queue[count++] = current_page;
+        }
+    }
+
+    for (int i = 0; i < cache->window_count && count < CACHE_QUEUE_SIZE; i++) {
+        int page_index = cache->window[i];
+        int wanted = find_entry(cache, page_index) < 0 && page_index != cache->failed_page;
+        for (int w = 0; wanted && w < cache->worker_count; w++) {
+            if (cache->workers[w].decoding == page_index && !cache->workers[w].tiles) wanted = 0;
+        }
+        for (int d = 0; wanted && d < cache->done_count; d++) {
+            if (cache->done[d].page_index == page_index && !cache->done[d].tiles) wanted = 0;
+        }
+        if (wanted) {
+            queue[count++] = page_index;
+        }
+    }
+
+    for (int i = 0; i < cache->queue_count; i++) {
+        int kept = 0;
+        for (int k = 0; k < count; k++) {
+            if (queue[k] == cache->queue[i]) kept = 1;
+        }
+        if (!kept) {
+            printf("Cancelled decode of page %d\n", cache->queue[i]);
+        }
+    }
+
+    memcpy(cache->queue, queue, count * sizeof(int));
+    cache->queue_count = count;
+    if (count > 0) {
+        SDL_CondSignal(cache->wake);
+    }
+
+    SDL_mutexV(cache->lock);
+}
+
+// Find the entry whose cache level is page, or -1
+static int find_surface(PageCache *cache, SDL_Surface *page) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; i++) {
+        if (page && cache->entries[i].surface == page) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+SDL_Surface *cache_get_fit_level(PageCache *cache, SDL_Surface *page, int view_w, int view_h) {
+    if (!page || (page->w <= view_w && page->h <= view_h)) {
+        return page;
+    }
+
+    // Decode workers make fit levels for the view last drawn
+    if (view_w != cache->view_w || view_h != cache->view_h) {
+        SDL_mutexP(cache->lock);
+        cache->view_w = view_w;
+        cache->view_h = view_h;
+        SDL_mutexV(cache->lock);
+    }
+
+    int slot = find_surface(cache, page);
+    if (slot < 0) {
+        return page;
+    }
+
+    // The level for this view, else the least recently drawn one to replace
+    CacheEntry *entry = &cache->entries[slot];
+    FitLevel *level = &entry->fit[0];
+    for (int i = 0; i < CACHE_FIT_LEVELS; i++) {
+        FitLevel *fit = &entry->fit[i];
+        if (fit->surface && fit->view_w == view_w && fit->view_h == view_h) {
+            fit->last_used = cache->access_counter;
+            return fit->surface;
+        }
+        if (level->surface && (!fit->surface || fit->last_used < level->last_used)) {
+            level = fit;
+        }
+    }
+
+    // First unzoomed draw in this orientation: area-scale once, then every
+    // frame is a plain blit
+    if (level->surface) {
+        SDL_FreeSurface(level->surface);
+    }
+    level->surface = scale_surface(page, view_w, view_h);
+    level->view_w = view_w;
+    level->view_h = view_h;
+    level->last_used = cache->access_counter;
+    trim_cache(cache);
+
+    return level->surface ? level->surface : page;
+}
+
+TiledPage *cache_get_tiled_level(PageCache *cache, SDL_Surface *page, float scale,
+                                 float *level_scale) {
+    *level_scale = scale;
+
+    int slot = find_surface(cache, page);
+    if (slot < 0 || scale <= 1.01f || cache->worker_count == 0) {
+        return NULL;
+    }
+
+    CacheEntry *entry = &cache->entries[slot];
+    if (entry->image_w <= 0 || entry->image_h <= 0 || entry->page_index == cache->tiles_failed) {
+        return NULL;
+    }
+
+    // The image fitted into HIRES_WIDTH x HIRES_HEIGHT, rounded like the
+    // decoders round the cache level
+    float scale_x = (float)HIRES_WIDTH / entry->image_w;
+    float scale_y = (float)HIRES_HEIGHT / entry->image_h;
+    float fit = (scale_x < scale_y) ? scale_x : scale_y;
+    if (fit > 1.0f) fit = 1.0f;
+    int width = (int)(entry->image_w * fit);
+    int height = (int)(entry->image_h * fit);
+
+    // Small pages are already at full resolution in the cache level
+    if (width <= page->w || height <= page->h) {
+        return NULL;
+    }
+
+    TiledPage *tiled = &cache->tiled;
+    if (tiled->page_index != entry->page_index || tiled->width != width || tiled->height != height) {
+        tiles_free(tiled);
+        if (tiles_init(tiled, entry->page_index, width, height) != 0) {
+            return NULL;
+        }
+        tiled->gray = is_gray_format(page->format);
+    }
+
+    // Snap to 1:1 when the level is (within rounding) the size wanted
+    *level_scale = scale * page->w / width;
+    if (*level_scale > 0.99f && *level_scale < 1.01f) {
+        *level_scale = 1.0f;
+    }
+    return tiled;
+}
+
+void cache_show_tiles(PageCache *cache, int x, int y, int w, int h) {
+    TiledPage *tiled = &cache->tiled;
+    if (!tiled->tiles) {
+        return;
+    }
+
+    // Visible tiles plus a ring of neighbours; an empty area keeps none
+    int col0 = (x >> TILE_SHIFT) - TILE_RING;
+    int row0 = (y >> TILE_SHIFT) - TILE_RING;
+    int col1 = ((x + w - 1) >> TILE_SHIFT) + TILE_RING;
+    int row1 = ((y + h - 1) >> TILE_SHIFT) + TILE_RING;
+    if (w <= 0 || h <= 0) {
+        col1 = col0 - 1;
+    }
+
+    SDL_mutexP(cache->lock);
+
+    // A request no worker has started yet is replaced by this one
+    TileJob *old = cache->tile_request;
+    cache->tile_request = NULL;
+    for (int row = old ? old->row0 : 0; old && row <= old->row1; row++) {
+        for (int col = old->col0; col <= old->col1; col++) {
+            Tile *tile = tiles_at(tiled, col, row);
+            if (tile && tile->pending == old->serial) tile->pending = 0;
+        }
+    }
+    free(old);
+
+    // Free what's out of range and find the bounds of what's missing
+    int miss_col0 = tiled->cols, miss_row0 = tiled->rows;
+    int miss_col1 = -1, miss_row1 = -1;
+    for (int row = 0; row < tiled->rows; row++) {
+        for (int col = 0; col < tiled->cols; col++) {
+            Tile *tile = tiles_at(tiled, col, row);
+            if (col < col0 || col > col1 || row < row0 || row > row1) {
+                if (tile->surface) {
+                    SDL_FreeSurface(tile->surface);
+                    tile->surface = NULL;
+                }
+                continue;
+            }
+            if (tile->surface || tile->pending) continue;
+
+            if (col < miss_col0) miss_col0 = col;
+            if (col > miss_col1) miss_col1 = col;
+            if (row < miss_row0) miss_row0 = row;
+            if (row > miss_row1) miss_row1 = row;
+        }
+    }
+
+    TileJob *job = (miss_col1 >= 0) ? (TileJob *)calloc(1, sizeof(TileJob)) : NULL;
+    if (job) {
+        job->serial = ++cache->tile_serial;
+        job->page_index = tiled->page_index;
+        job->width = tiled->width;
+        job->height = tiled->height;
+        job->col0 = miss_col0;
+        job->row0 = miss_row0;
+        job->col1 = miss_col1;
+        job->row1 = miss_row1;
+        job->rgb565 = cache->rgb565;
+        job->gray = tiled->gray;
+        for (int row = miss_row0; row <= miss_row1; row++) {
+            for (int col = miss_col0; col <= miss_col1; col++) {
+                Tile *tile = tiles_at(tiled, col, row);
+                if (!tile->surface && !tile->pending) tile->pending = job->serial;
+            }
+        }
+        cache->tile_request = job;
+        SDL_CondSignal(cache->wake);
+    }
+
+    SDL_mutexV(cache->lock);
 
-    // Preload previous page
-    if (current_page - 1 >= 0) {
-        cache_get_page(cache, current_page - 1);
+    // Pages make room for the tiles just asked for
+    if (job) {
+        trim_cache(cache);
     }
 }
@@ -3,8 +3,11 @@
 
 #include <SDL.h>
 #include "cbz.h"
+#include "tiles.h"
+#include "disk_cache.h"
 
-#define CACHE_SIZE 3  // Keep 3 pages in memory
+// Pages are kept while their surfaces fit a byte budget, at most this many
+#define CACHE_MAX_ENTRIES 16
 
 // Screen dimensions for scaling
 #define SCREEN_WIDTH 1024
@@ -14,31 +17,159 @@
 #define CACHE_WIDTH 1536
 #define CACHE_HEIGHT 1152
 
-// Cached page entry
+// High resolution zoom level (what 3x zoom shows 1:1), decoded in tiles on
+// demand for the page being zoomed
+#define HIRES_WIDTH (CACHE_WIDTH * 2)
+#define HIRES_HEIGHT (CACHE_HEIGHT * 2)
+
+// Max pages waiting for the decode workers
+#define CACHE_QUEUE_SIZE 8
+
+// Pages always read ahead in the reading direction; more are read ahead
+// when pages go by faster than they decode
+#define CACHE_MIN_AHEAD 2
+
+// Decode worker threads (each extracts with its own archive handle)
+#define CACHE_WORKERS COMIC_MAX_HANDLES
+
+// SDL_USEREVENT code pushed by the decode worker when a page is ready
+#define CACHE_EVENT_PAGE_READY 1
+
+// Fit-to-view levels kept per page: one for each orientation's view
+#define CACHE_FIT_LEVELS 2
+
+// Page scaled down to fit a view, drawn unzoomed with a plain blit
+typedef struct {
+    SDL_Surface *surface;   // NULL if none
+    int view_w;             // View size it was made for
+    int view_h;
+    unsigned int last_used; // The least recently drawn one is replaced
+} FitLevel;
+
+// Cached page entry. Besides the cache level each page carries a small
+// pyramid so every zoom is drawn close to 1:1 from one of its levels; the
+// tiled high resolution level is kept by the cache for the zoomed page.
 typedef struct {
     int page_index;         // -1 if unused
-    SDL_Surface *surface;   // Scaled image
-    unsigned int last_used; // For LRU eviction
+    SDL_Surface *surface;   // Cache level, fits CACHE_WIDTH x CACHE_HEIGHT
+    FitLevel fit[CACHE_FIT_LEVELS];
+    int image_w;            // Full size of the page image, 0 if it can't be tiled
+    int image_h;
+    unsigned int last_used; // Breaks eviction ties, least recently used goes first
 } CacheEntry;
 
-// Page cache
+// Page decoded by a worker, waiting to be picked up by the main thread
+typedef struct {
+    int page_index;
+    SDL_Surface *surface;   // NULL if decoding failed
+    SDL_Surface *fit;       // Fit level for fit_view_w x fit_view_h, or NULL
+    int fit_view_w;
+    int fit_view_h;
+    int image_w;            // As in CacheEntry
+    int image_h;
+    Uint32 decode_ms;       // Time the worker took
+    TileJob *tiles;         // Set instead for a finished tile job
+} DecodedPage;
+
+struct PageCache;
+
+// Decode worker thread
 typedef struct {
-    CacheEntry entries[CACHE_SIZE];
+    SDL_Thread *thread;
+    struct PageCache *cache;
+    int decoding;           // Page the worker is on, -1 if idle
+    int tiles;              // 1 if decoding tiles
+    TileDecoder tiler;      // Page kept open between tile jobs
+} DecodeWorker;
+
+// Page cache
+typedef struct PageCache {
+    CacheEntry entries[CACHE_MAX_ENTRIES];
     unsigned int access_counter;
+    size_t budget;          // Max bytes of page surfaces to keep
+    int rgb565;             // 1 on a 16-bit screen: pages are dithered to RGB565
     ComicBook *comic;       // Reference to comic book
+    int current_page;       // Page last asked for, eviction keeps pages near it
+    int view_w;             // View last drawn unzoomed, workers make fit levels
+    int view_h;             // for it (0 until known)
+    int last_page;          // Last page handed out ready (placeholder source)
+
+    // Prefetch planning
+    int direction;          // Reading direction, 1 forward or -1 backward
+    int last_step;          // Direction of the last page turn
+    int step_streak;        // Page turns in a row in that direction
+    Uint32 page_shown_at;   // Ticks when the current page was first asked for
+    Uint32 page_ms;         // Average time spent per page, 0 until known
+    Uint32 decode_ms;       // Average page decode time, 0 until known
+    int window[CACHE_MAX_ENTRIES];  // Pages wanted besides the current one, most wanted first
+    int window_count;
+    int failed_page;        // Last page that failed to decode, -1 if none
+
+    // Decode workers (own extraction, decoding and scaling)
+    DecodeWorker workers[CACHE_WORKERS];
+    int worker_count;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    int quit;
+    int queue[CACHE_QUEUE_SIZE];        // Pages to decode, front first
+    int queue_count;
+    TileJob *tile_request;              // Tiles to decode once no page is queued
+    int tiles_failed;                   // Page whose tiles failed to decode, -1 if none
+    int tile_serial;                    // Serial of the last tile job
+    DecodedPage done[CACHE_QUEUE_SIZE]; // Finished pages for the main thread
+    int done_count;
+
+    TiledPage tiled;        // High resolution level of the zoomed page
+    DiskCache disk;         // Decoded pages kept on flash
 } PageCache;
 
-// Initialize cache
-void cache_init(PageCache *cache, ComicBook *comic);
+// Initialize cache and start the decode workers. Pages are kept while
+// their surfaces take up to budget bytes (the page being read always stays);
+// decoded pages are also kept on flash within disk_budget bytes (0 = off).
+void cache_init(PageCache *cache, ComicBook *comic, size_t budget, long long disk_budget);
 
 // Free all cached surfaces
 void cache_clear(PageCache *cache);
 
-// Get a page surface (loads and caches if needed)
-// Returns scaled SDL_Surface, or NULL on error
-SDL_Surface *cache_get_page(PageCache *cache, int page_index);
+// Stop the decode workers and free everything (call before comic_close)
+void cache_destroy(PageCache *cache);
+
+// Collect pages and tiles finished by the decode workers into the cache.
+// Must be called from the main thread; returns number of results collected
+// (failed pages included), 0 if nothing on screen can have changed.
+int cache_pump(PageCache *cache);
 
-// Preload adjacent pages in background (call after getting current page)
+// Get a page surface without blocking. If the page isn't decoded yet it is
+// queued and the last ready page (or NULL) is returned as a placeholder.
+// *ready is set to 1 once the page is done (returns NULL if it failed).
+SDL_Surface *cache_get_page(PageCache *cache, int page_index, int *ready);
+
+// Queue a page for background decoding if it isn't cached or queued already.
+// Urgent requests jump to the front of the queue.
+void cache_request_page(PageCache *cache, int page_index, int urgent);
+
+// Plan which pages around the current one to decode in the background and
+// queue them, dropping queued pages that are no longer wanted. Pages ahead
+// in the reading direction come first, as many as go by while one decodes
+// (at least CACHE_MIN_AHEAD), then the page behind; all within the budget.
+// Call after getting the current page.
 void cache_preload_adjacent(PageCache *cache, int current_page);
 
+// Get the fit-to-view level of a page surface returned by cache_get_page.
+// Levels for the view size last asked for are made by the decode workers
+// along with the page; others are made here on first use, and one is kept
+// per orientation. Returns page itself if it fits.
+SDL_Surface *cache_get_fit_level(PageCache *cache, SDL_Surface *page, int view_w, int view_h);
+
+// Get the tiled high resolution level of a page surface returned by
+// cache_get_page when drawing it at scale (display pixels per page pixel)
+// is better served by it. Returns NULL to draw page itself. Otherwise
+// *level_scale is set to the scale to draw the level at.
+TiledPage *cache_get_tiled_level(PageCache *cache, SDL_Surface *page, float scale,
+                                 float *level_scale);
+
+// Note which part of the tiled level is on screen (in level pixels): tiles
+// there and in a ring around are queued for decoding, the rest are freed
+void cache_show_tiles(PageCache *cache, int x, int y, int w, int h);
+
 #endif
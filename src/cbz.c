@@ -1,5 +1,7 @@
 #include "cbz.h"
+#include "archive_index.h"
 #include "unzip.h"
+#include "iommap.h"
 #include "unarr.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,28 +35,50 @@ static const char *get_basename(const char *path) {
     return path;
 }
 
+// Build the natural sort key of a name into out (NULL to just measure).
+// Letters are lowercased and each run of digits becomes '0', the number of
+// digits without leading zeros, then those digits, so keys compare in
+// natural order with a plain memcmp. Returns the key length.
+static size_t make_sort_key(const char *name, unsigned char *out) {
+    size_t len = 0;
+
+    while (*name) {
+        if (isdigit((unsigned char)*name)) {
+            while (*name == '0') name++;
+            const char *digits = name;
+            while (isdigit((unsigned char)*name)) name++;
+            size_t count = name - digits;
+
+            if (out) {
+                out[len] = '0';
+                out[len + 1] = (count > 255) ? 255 : (unsigned char)count;
+                memcpy(out + len + 2, digits, count);
+            }
+            len += 2 + count;
+        } else {
+            if (out) out[len] = tolower((unsigned char)*name);
+            len++;
+            name++;
+        }
+    }
+
+    return len;
+}
+
 // Compare function for sorting pages (natural sort)
 static int compare_pages(const void *a, const void *b) {
     const PageInfo *pa = (const PageInfo *)a;
     const PageInfo *pb = (const PageInfo *)b;
 
-    const char *name_a = get_basename(pa->filename);
-    const char *name_b = get_basename(pb->filename);
-
-    while (*name_a && *name_b) {
-        if (isdigit(*name_a) && isdigit(*name_b)) {
-            long num_a = strtol(name_a, (char**)&name_a, 10);
-            long num_b = strtol(name_b, (char**)&name_b, 10);
-            if (num_a != num_b) return (num_a < num_b) ? -1 : 1;
-        } else {
-            int diff = tolower(*name_a) - tolower(*name_b);
-            if (diff != 0) return diff;
-            name_a++;
-            name_b++;
-        }
+    unsigned int len = (pa->sort_key_len < pb->sort_key_len) ? pa->sort_key_len : pb->sort_key_len;
+    int diff = memcmp(pa->sort_key, pb->sort_key, len);
+    if (diff != 0) return diff;
+    if (pa->sort_key_len != pb->sort_key_len) {
+        return (pa->sort_key_len < pb->sort_key_len) ? -1 : 1;
     }
 
-    return strlen(name_a) - strlen(name_b);
+    // Same natural order (e.g. "01.jpg" and "1.jpg"), keep the sort stable
+    return strcmp(pa->filename, pb->filename);
 }
 
 // Detect format from file extension
@@ -79,20 +103,27 @@ static ComicFormat detect_format(const char *filepath) {
 
 // ============== CBZ (ZIP) Functions ==============
 
-static int cbz_open_internal(ComicBook *comic, const char *filepath) {
-    unzFile zip = unzOpen(filepath);
+static int cbz_open_handle(ComicBook *comic, ArchiveHandle *handle) {
+    // Read through a memory mapping instead of stdio (falls back if it can't map)
+    zlib_filefunc64_def filefunc;
+    fill_mmap_filefunc64(&filefunc);
+    filefunc.opaque = &handle->map;
+
+    unzFile zip = unzOpen2_64(comic->filepath, &filefunc);
     if (!zip) {
-        fprintf(stderr, "Failed to open CBZ: %s\n", filepath);
+        fprintf(stderr, "Failed to open CBZ: %s\n", comic->filepath);
         return -1;
     }
 
-    comic->archive_handle = zip;
-    comic->page_count = 0;
+    handle->archive = zip;
+    return 0;
+}
+
+static int cbz_scan_internal(ComicBook *comic) {
+    unzFile zip = (unzFile)comic->handles[0].archive;
 
     if (unzGoToFirstFile(zip) != UNZ_OK) {
         fprintf(stderr, "Empty or invalid CBZ file\n");
-        unzClose(zip);
-        comic->archive_handle = NULL;
         return -1;
     }
 
@@ -114,25 +145,32 @@ static int cbz_open_internal(ComicBook *comic, const char *filepath) {
         if (basename[0] == '.') continue;
         if (strstr(filename, "__MACOSX") != NULL) continue;
 
-        if (comic->page_count >= MAX_PAGES) break;
+        // Remember where the entry lives so extraction can jump straight to it
+        unz64_file_pos pos;
+        if (unzGetFilePos64(zip, &pos) != UNZ_OK) continue;
 
-        PageInfo *page = &comic->pages[comic->page_count];
-        strncpy(page->filename, filename, MAX_FILENAME - 1);
+        PageInfo *page = comic_add_page(comic, filename, strlen(filename));
+        if (!page) return -1;
         page->compressed_size = file_info.compressed_size;
         page->uncompressed_size = file_info.uncompressed_size;
-        page->offset = 0;
-        comic->page_count++;
+        page->offset = pos.pos_in_zip_directory;
+        page->entry_index = pos.num_of_file;
 
     } while (unzGoToNextFile(zip) == UNZ_OK);
 
     return (comic->page_count > 0) ? 0 : -1;
 }
 
-static unsigned char *cbz_extract_internal(ComicBook *comic, int page_index, size_t *out_size) {
+static unsigned char *cbz_extract_internal(ComicBook *comic, ArchiveHandle *handle,
+                                           int page_index, size_t *out_size) {
     PageInfo *page = &comic->pages[page_index];
-    unzFile zip = (unzFile)comic->archive_handle;
+    unzFile zip = (unzFile)handle->archive;
 
-    if (unzLocateFile(zip, page->filename, 0) != UNZ_OK) {
+    unz64_file_pos pos;
+    pos.pos_in_zip_directory = page->offset;
+    pos.num_of_file = page->entry_index;
+
+    if (unzGoToFilePos64(zip, &pos) != UNZ_OK) {
         fprintf(stderr, "Failed to locate page: %s\n", page->filename);
         return NULL;
     }
@@ -161,33 +199,83 @@ static unsigned char *cbz_extract_internal(ComicBook *comic, int page_index, siz
     return data;
 }
 
-static void cbz_close_internal(ComicBook *comic) {
-    if (comic->archive_handle) {
-        unzClose((unzFile)comic->archive_handle);
+// Stored (uncompressed) entries can be handed out as a view into the
+// archive mapping, skipping the malloc and copy through minizip
+static int cbz_view_stored(ComicBook *comic, ArchiveHandle *handle, int page_index, PageData *out) {
+    PageInfo *page = &comic->pages[page_index];
+    unzFile zip = (unzFile)handle->archive;
+
+    if (!handle->map.data) {
+        return -1;
     }
+
+    unz64_file_pos pos;
+    pos.pos_in_zip_directory = page->offset;
+    pos.num_of_file = page->entry_index;
+
+    unz_file_info64 info;
+    if (unzGoToFilePos64(zip, &pos) != UNZ_OK ||
+        unzGetCurrentFileInfo64(zip, &info, NULL, 0, NULL, 0, NULL, 0) != UNZ_OK) {
+        return -1;
+    }
+
+    // Method 0, not encrypted
+    if (info.compression_method != 0 || (info.flag & 1) ||
+        info.compressed_size != info.uncompressed_size) {
+        return -1;
+    }
+
+    // Opening the entry parses its local header to find where the data starts
+    if (unzOpenCurrentFile(zip) != UNZ_OK) {
+        return -1;
+    }
+    ZPOS64_T start = unzGetCurrentFileZStreamPos64(zip);
+    unzCloseCurrentFile(zip);
+
+    if (start == 0 || start > handle->map.size ||
+        info.uncompressed_size > handle->map.size - start) {
+        return -1;
+    }
+
+    out->data = handle->map.data + start;
+    out->size = info.uncompressed_size;
+    out->buffer = NULL;
+    return 0;
+}
+
+static void cbz_close_handle(ArchiveHandle *handle) {
+    unzClose((unzFile)handle->archive);
 }
 
 // ============== CBR (RAR) Functions ==============
 
-static int cbr_open_internal(ComicBook *comic, const char *filepath) {
-    ar_stream *stream = ar_open_file(filepath);
+static int cbr_open_handle(ComicBook *comic, ArchiveHandle *handle) {
+    ar_stream *stream = ar_open_mapped_file(comic->filepath);
     if (!stream) {
-        fprintf(stderr, "Failed to open file: %s\n", filepath);
+        fprintf(stderr, "Failed to open file: %s\n", comic->filepath);
         return -1;
     }
 
     ar_archive *ar = ar_open_rar_archive(stream);
     if (!ar) {
-        fprintf(stderr, "Failed to open RAR archive: %s\n", filepath);
+        fprintf(stderr, "Failed to open RAR archive: %s\n", comic->filepath);
         ar_close(stream);
         return -1;
     }
 
-    comic->archive_handle = ar;
-    comic->page_count = 0;
+    // RAR entries can only be parsed after the main header has been seen
+    ar_parse_entry_at(ar, 0);
+
+    handle->archive = ar;
+    handle->stream = stream;
+    return 0;
+}
+
+static int cbr_scan_internal(ComicBook *comic) {
+    ar_archive *ar = (ar_archive *)comic->handles[0].archive;
 
     // Scan all entries
-    while (ar_parse_entry(ar)) {
+    for (int ok = ar_parse_entry_at(ar, 0); ok; ok = ar_parse_entry(ar)) {
         const char *name = ar_entry_get_name(ar);
         if (!name) continue;
 
@@ -198,28 +286,108 @@ static int cbr_open_internal(ComicBook *comic, const char *filepath) {
         const char *basename = get_basename(name);
         if (basename[0] == '.') continue;
 
-        if (comic->page_count >= MAX_PAGES) break;
-
-        PageInfo *page = &comic->pages[comic->page_count];
-        strncpy(page->filename, name, MAX_FILENAME - 1);
+        PageInfo *page = comic_add_page(comic, name, strlen(name));
+        if (!page) return -1;
         page->uncompressed_size = ar_entry_get_size(ar);
         page->offset = ar_entry_get_offset(ar);
-        comic->page_count++;
     }
 
-    if (comic->page_count == 0) {
-        ar_close_archive(ar);
-        ar_close(stream);
-        comic->archive_handle = NULL;
-        return -1;
+    return (comic->page_count > 0) ? 0 : -1;
+}
+
+// Find the page stored at a given entry offset, or -1 if it isn't a page
+static int find_page_at_offset(ComicBook *comic, long long offset) {
+    for (int i = 0; i < comic->page_count; i++) {
+        if (comic->pages[i].offset == offset) return i;
     }
+    return -1;
+}
 
-    return 0;
+// Decode the current entry fully, keeping the bytes if it's a page
+static unsigned char *cbr_decode_entry(ar_archive *ar, size_t *out_size) {
+    size_t size = ar_entry_get_size(ar);
+    unsigned char *data = (unsigned char *)malloc(size ? size : 1);
+    if (!data) {
+        return NULL;
+    }
+
+    if (size > 0 && !ar_entry_uncompress(ar, data, size)) {
+        free(data);
+        return NULL;
+    }
+
+    *out_size = size;
+    return data;
 }
 
-static unsigned char *cbr_extract_internal(ComicBook *comic, int page_index, size_t *out_size) {
+// Solid archives can only be decoded front to back. Walk forward from the
+// last decoded entry (or from the nearest decoder checkpoint when going
+// backwards), spilling every page passed on the way so later visits skip
+// the decoder. Solid CBRs only ever get one archive handle, so holding it
+// also guards solid_last and the spill store.
+static unsigned char *cbr_extract_solid(ComicBook *comic, ArchiveHandle *handle,
+                                        int page_index, size_t *out_size) {
     PageInfo *page = &comic->pages[page_index];
-    ar_archive *ar = (ar_archive *)comic->archive_handle;
+    ar_archive *ar = (ar_archive *)handle->archive;
+
+    unsigned char *data = spill_get(&comic->spill, page_index, out_size);
+    if (data) {
+        return data;
+    }
+
+    int ok;
+    if (comic->solid_last < 0 || page->offset <= comic->solid_last) {
+        printf("Restarting solid decode for page %d\n", page_index);
+        ok = ar_parse_entry_at(ar, ar_rar_get_checkpoint(ar, page->offset));
+    } else {
+        ok = ar_parse_entry(ar);
+    }
+
+    while (ok) {
+        long long offset = ar_entry_get_offset(ar);
+        int index = find_page_at_offset(comic, offset);
+
+        if (index == page_index || spill_wants(&comic->spill, index, ar_entry_get_size(ar))) {
+            size_t size;
+            unsigned char *entry = cbr_decode_entry(ar, &size);
+            if (!entry) break;
+            comic->solid_last = offset;
+            spill_put(&comic->spill, index, entry, size);
+
+            if (index == page_index) {
+                *out_size = size;
+                return entry;
+            }
+            free(entry);
+        } else {
+            // Not a page, already spilled or over budget: decode and drop
+            size_t left = ar_entry_get_size(ar);
+            unsigned char buffer[4096];
+            while (left > 0) {
+                size_t count = left < sizeof(buffer) ? left : sizeof(buffer);
+                if (!ar_entry_uncompress(ar, buffer, count)) break;
+                left -= count;
+            }
+            if (left > 0) break;
+            comic->solid_last = offset;
+        }
+
+        ok = ar_parse_entry(ar);
+    }
+
+    fprintf(stderr, "Failed to extract page: %s\n", page->filename);
+    comic->solid_last = -1;
+    return NULL;
+}
+
+static unsigned char *cbr_extract_internal(ComicBook *comic, ArchiveHandle *handle,
+                                           int page_index, size_t *out_size) {
+    PageInfo *page = &comic->pages[page_index];
+    ar_archive *ar = (ar_archive *)handle->archive;
+
+    if (comic->solid) {
+        return cbr_extract_solid(comic, handle, page_index, out_size);
+    }
 
     // Seek to the page's offset
     if (!ar_parse_entry_at(ar, page->offset)) {
@@ -244,15 +412,289 @@ static unsigned char *cbr_extract_internal(ComicBook *comic, int page_index, siz
     return data;
 }
 
-static void cbr_close_internal(ComicBook *comic) {
-    if (comic->archive_handle) {
-        ar_archive *ar = (ar_archive *)comic->archive_handle;
-        // Get the stream before closing archive
-        ar_close_archive(ar);
-        // Note: stream is closed internally by unarr
+static void cbr_close_handle(ArchiveHandle *handle) {
+    ar_close_archive((ar_archive *)handle->archive);
+    // unarr doesn't close the stream with the archive
+    ar_close((ar_stream *)handle->stream);
+}
+
+// ============== Archive Handles ==============
+
+// Each handle has its own read position, so decode workers can extract
+// different pages at once. Handles beyond the first are opened on demand.
+
+static int archive_handle_open(ComicBook *comic, ArchiveHandle *handle) {
+    memset(handle, 0, sizeof(ArchiveHandle));
+    return (comic->format == COMIC_FORMAT_CBZ) ? cbz_open_handle(comic, handle)
+                                               : cbr_open_handle(comic, handle);
+}
+
+static void archive_handle_close(ComicBook *comic, ArchiveHandle *handle) {
+    if (handle->archive) {
+        if (comic->format == COMIC_FORMAT_CBZ) {
+            cbz_close_handle(handle);
+        } else {
+            cbr_close_handle(handle);
+        }
+    }
+    memset(handle, 0, sizeof(ArchiveHandle));
+}
+
+// Take a free handle, opening another one if allowed. Blocks while all
+// handles are busy.
+static ArchiveHandle *acquire_handle(ComicBook *comic) {
+    if (!comic->handle_lock) {
+        return &comic->handles[0];
+    }
+
+    SDL_mutexP(comic->handle_lock);
+    for (;;) {
+        for (int i = 0; i < comic->handle_count; i++) {
+            if (!comic->handles[i].in_use) {
+                comic->handles[i].in_use = 1;
+                SDL_mutexV(comic->handle_lock);
+                return &comic->handles[i];
+            }
+        }
+
+        if (comic->handle_count < comic->handle_limit) {
+            ArchiveHandle *handle = &comic->handles[comic->handle_count];
+            if (archive_handle_open(comic, handle) == 0) {
+                comic->handle_count++;
+                handle->in_use = 1;
+                SDL_mutexV(comic->handle_lock);
+                return handle;
+            }
+            // Can't open more, share the ones we have
+            comic->handle_limit = comic->handle_count;
+            continue;
+        }
+
+        SDL_CondWait(comic->handle_free, comic->handle_lock);
     }
 }
 
+static void release_handle(ComicBook *comic, ArchiveHandle *handle) {
+    if (!comic->handle_lock) {
+        return;
+    }
+
+    SDL_mutexP(comic->handle_lock);
+    handle->in_use = 0;
+    SDL_CondSignal(comic->handle_free);
+    SDL_mutexV(comic->handle_lock);
+}
+
+// ============== Page Streams ==============
+
+// Compressed pages are inflated on demand as the image decoder reads them,
+// so the whole compressed image never has to sit in memory. The leading
+// bytes are kept so format sniffing can rewind without restarting the entry.
+#define PAGE_STREAM_HEAD 4096
+
+typedef struct {
+    ComicBook *comic;
+    ArchiveHandle *handle;  // Held while streaming, NULL otherwise
+    int page_index;
+    PageData data;          // Whole page in memory, data.data is NULL when streaming
+    size_t size;            // Page size in bytes
+    size_t pos;             // Read position seen by the decoder
+    size_t entry_pos;       // Bytes produced by the open archive entry
+    int entry_open;
+    unsigned char head[PAGE_STREAM_HEAD];
+} PageStream;
+
+static void page_stream_stop(PageStream *ps) {
+    if (ps->entry_open && ps->comic->format == COMIC_FORMAT_CBZ) {
+        unzCloseCurrentFile((unzFile)ps->handle->archive);
+    }
+    ps->entry_open = 0;
+}
+
+// (Re)open the page's archive entry at its first byte
+static int page_stream_start(PageStream *ps) {
+    PageInfo *page = &ps->comic->pages[ps->page_index];
+
+    page_stream_stop(ps);
+    ps->entry_pos = 0;
+
+    if (ps->comic->format == COMIC_FORMAT_CBZ) {
+        unzFile zip = (unzFile)ps->handle->archive;
+        unz64_file_pos pos;
+        pos.pos_in_zip_directory = page->offset;
+        pos.num_of_file = page->entry_index;
+        if (unzGoToFilePos64(zip, &pos) != UNZ_OK || unzOpenCurrentFile(zip) != UNZ_OK) {
+            return -1;
+        }
+    } else {
+        if (!ar_parse_entry_at((ar_archive *)ps->handle->archive, page->offset)) {
+            return -1;
+        }
+    }
+
+    ps->entry_open = 1;
+    return 0;
+}
+
+// Read the next bytes of the archive entry, returns bytes read (0 on error)
+static size_t page_stream_pull(PageStream *ps, unsigned char *buffer, size_t count) {
+    if (!ps->entry_open || ps->entry_pos >= ps->size) {
+        return 0;
+    }
+    if (count > ps->size - ps->entry_pos) {
+        count = ps->size - ps->entry_pos;
+    }
+
+    if (ps->comic->format == COMIC_FORMAT_CBZ) {
+        int n = unzReadCurrentFile((unzFile)ps->handle->archive, buffer, count);
+        if (n <= 0) return 0;
+        count = n;
+    } else {
+        if (!ar_entry_uncompress((ar_archive *)ps->handle->archive, buffer, count)) return 0;
+    }
+
+    if (ps->entry_pos < PAGE_STREAM_HEAD) {
+        size_t keep = PAGE_STREAM_HEAD - ps->entry_pos;
+        memcpy(ps->head + ps->entry_pos, buffer, count < keep ? count : keep);
+    }
+    ps->entry_pos += count;
+    return count;
+}
+
+static int page_rw_seek(SDL_RWops *rw, int offset, int whence) {
+    PageStream *ps = (PageStream *)rw->hidden.unknown.data1;
+    long long pos;
+
+    switch (whence) {
+        case RW_SEEK_SET: pos = offset; break;
+        case RW_SEEK_CUR: pos = (long long)ps->pos + offset; break;
+        case RW_SEEK_END: pos = (long long)ps->size + offset; break;
+        default: return -1;
+    }
+    if (pos < 0) {
+        SDL_SetError("Seek before start of page");
+        return -1;
+    }
+
+    ps->pos = (pos > (long long)ps->size) ? ps->size : (size_t)pos;
+    return (int)ps->pos;
+}
+
+static int page_rw_read(SDL_RWops *rw, void *ptr, int size, int maxnum) {
+    PageStream *ps = (PageStream *)rw->hidden.unknown.data1;
+    unsigned char *out = (unsigned char *)ptr;
+    size_t want, done = 0;
+
+    if (size <= 0 || maxnum <= 0) {
+        return 0;
+    }
+    want = (size_t)size * maxnum;
+    if (want > ps->size - ps->pos) {
+        want = ps->size - ps->pos;
+    }
+
+    if (ps->data.data) {
+        memcpy(out, ps->data.data + ps->pos, want);
+        ps->pos += want;
+        return (int)(want / size);
+    }
+
+    while (done < want) {
+        size_t count = want - done;
+        size_t head_len = ps->entry_pos < PAGE_STREAM_HEAD ? ps->entry_pos : PAGE_STREAM_HEAD;
+
+        if (ps->pos < head_len && ps->pos != ps->entry_pos) {
+            // Rewound into the bytes already seen
+            if (count > head_len - ps->pos) count = head_len - ps->pos;
+            memcpy(out + done, ps->head + ps->pos, count);
+        } else {
+            // Rewound past the head: start the entry over
+            if (ps->pos < ps->entry_pos && page_stream_start(ps) != 0) break;
+
+            // Skip forward to the read position
+            while (ps->entry_pos < ps->pos) {
+                unsigned char skip[4096];
+                size_t n = ps->pos - ps->entry_pos;
+                if (n > sizeof(skip)) n = sizeof(skip);
+                if (page_stream_pull(ps, skip, n) == 0) break;
+            }
+            if (ps->entry_pos != ps->pos) break;
+
+            count = page_stream_pull(ps, out + done, count);
+            if (count == 0) break;
+        }
+
+        ps->pos += count;
+        done += count;
+    }
+
+    return (int)(done / size);
+}
+
+static int page_rw_write(SDL_RWops *rw, const void *ptr, int size, int num) {
+    SDL_SetError("Page streams are read-only");
+    return -1;
+}
+
+static int page_rw_close(SDL_RWops *rw) {
+    if (rw) {
+        PageStream *ps = (PageStream *)rw->hidden.unknown.data1;
+        if (ps->handle) {
+            page_stream_stop(ps);
+            release_handle(ps->comic, ps->handle);
+        }
+        comic_release_page_data(&ps->data);
+        free(ps);
+        SDL_FreeRW(rw);
+    }
+    return 0;
+}
+
+// ============== Page Table ==============
+
+static void clear_pages(ComicBook *comic) {
+    free(comic->pages);
+    comic->pages = NULL;
+    comic->page_count = 0;
+    comic->page_capacity = 0;
+    arena_free(&comic->names);
+}
+
+PageInfo *comic_add_page(ComicBook *comic, const char *filename, size_t name_len) {
+    if (comic->page_count == comic->page_capacity) {
+        int capacity = comic->page_capacity ? comic->page_capacity * 2 : 64;
+        PageInfo *pages = (PageInfo *)realloc(comic->pages, capacity * sizeof(PageInfo));
+        if (!pages) {
+            fprintf(stderr, "Out of memory for page table (%d pages)\n", capacity);
+            return NULL;
+        }
+        comic->pages = pages;
+        comic->page_capacity = capacity;
+    }
+
+    const char *name = arena_strndup(&comic->names, filename, name_len);
+    if (!name) {
+        fprintf(stderr, "Out of memory for page names\n");
+        return NULL;
+    }
+
+    // Sort keys are built once here instead of on every comparison
+    size_t key_len = make_sort_key(get_basename(name), NULL);
+    unsigned char *key = (unsigned char *)arena_alloc(&comic->names, key_len);
+    if (!key) {
+        fprintf(stderr, "Out of memory for page names\n");
+        return NULL;
+    }
+    make_sort_key(get_basename(name), key);
+
+    PageInfo *page = &comic->pages[comic->page_count++];
+    memset(page, 0, sizeof(PageInfo));
+    page->filename = name;
+    page->sort_key = key;
+    page->sort_key_len = key_len;
+    return page;
+}
+
 // ============== Public API ==============
 
 int comic_open(ComicBook *comic, const char *filepath) {
@@ -260,26 +702,56 @@ int comic_open(ComicBook *comic, const char *filepath) {
     strncpy(comic->filepath, filepath, sizeof(comic->filepath) - 1);
 
     comic->format = detect_format(filepath);
-
-    int result;
-    switch (comic->format) {
-        case COMIC_FORMAT_CBZ:
-            result = cbz_open_internal(comic, filepath);
-            break;
-        case COMIC_FORMAT_CBR:
-            result = cbr_open_internal(comic, filepath);
-            break;
-        default:
-            fprintf(stderr, "Unknown comic format: %s\n", filepath);
-            return -1;
+    if (comic->format == COMIC_FORMAT_UNKNOWN) {
+        fprintf(stderr, "Unknown comic format: %s\n", filepath);
+        return -1;
     }
 
+    int result = archive_handle_open(comic, &comic->handles[0]);
     if (result != 0) {
         return result;
     }
+    comic->handle_count = 1;
+    comic->handle_limit = COMIC_MAX_HANDLES;
+
+    // Reuse the page table from a previous open if the archive is unchanged
+    if (archive_index_load(comic) != 0) {
+        clear_pages(comic);
+        result = (comic->format == COMIC_FORMAT_CBZ) ? cbz_scan_internal(comic)
+                                                     : cbr_scan_internal(comic);
+        if (result != 0) {
+            comic_close(comic);
+            return result;
+        }
+
+        // Sort pages naturally
+        qsort(comic->pages, comic->page_count, sizeof(PageInfo), compare_pages);
+
+        archive_index_save(comic);
+    }
+
+    if (comic->format == COMIC_FORMAT_CBR) {
+        ar_archive *ar = (ar_archive *)comic->handles[0].archive;
+        comic->solid = ar_rar_is_solid(ar);
+        comic->solid_last = -1;
+        if (comic->solid) {
+            // Solid entries decode in order, more handles wouldn't help
+            comic->handle_limit = 1;
+            spill_open(&comic->spill, comic->page_count, SPILL_MAX_BYTES);
+            ar_rar_set_checkpoints(ar, SOLID_CHECKPOINT_INTERVAL, SOLID_CHECKPOINT_MAX_BYTES);
+        }
+    }
 
-    // Sort pages naturally
-    qsort(comic->pages, comic->page_count, sizeof(PageInfo), compare_pages);
+    // Without a lock all extraction goes through the first handle
+    comic->handle_lock = SDL_CreateMutex();
+    comic->handle_free = SDL_CreateCond();
+    if (!comic->handle_lock || !comic->handle_free) {
+        fprintf(stderr, "Failed to create archive handle lock\n");
+        if (comic->handle_lock) SDL_DestroyMutex(comic->handle_lock);
+        if (comic->handle_free) SDL_DestroyCond(comic->handle_free);
+        comic->handle_lock = NULL;
+        comic->handle_free = NULL;
+    }
 
     printf("Opened comic: %s (%d pages, format: %s)\n",
            filepath, comic->page_count,
@@ -289,37 +761,128 @@ int comic_open(ComicBook *comic, const char *filepath) {
 }
 
 void comic_close(ComicBook *comic) {
-    switch (comic->format) {
-        case COMIC_FORMAT_CBZ:
-            cbz_close_internal(comic);
-            break;
-        case COMIC_FORMAT_CBR:
-            cbr_close_internal(comic);
-            break;
-        default:
-            break;
-    }
-    comic->archive_handle = NULL;
-    comic->page_count = 0;
+    for (int i = 0; i < comic->handle_count; i++) {
+        archive_handle_close(comic, &comic->handles[i]);
+    }
+    comic->handle_count = 0;
+    spill_close(&comic->spill);
+    clear_pages(comic);
+
+    if (comic->handle_free) {
+        SDL_DestroyCond(comic->handle_free);
+        comic->handle_free = NULL;
+    }
+    if (comic->handle_lock) {
+        SDL_DestroyMutex(comic->handle_lock);
+        comic->handle_lock = NULL;
+    }
 }
 
 int comic_page_count(ComicBook *comic) {
     return comic->page_count;
 }
 
+static unsigned char *extract_page(ComicBook *comic, ArchiveHandle *handle,
+                                   int page_index, size_t *out_size) {
+    return (comic->format == COMIC_FORMAT_CBZ) ? cbz_extract_internal(comic, handle, page_index, out_size)
+                                               : cbr_extract_internal(comic, handle, page_index, out_size);
+}
+
+static int get_page_data(ComicBook *comic, ArchiveHandle *handle, int page_index, PageData *page) {
+    memset(page, 0, sizeof(PageData));
+    if (comic->format == COMIC_FORMAT_CBZ && cbz_view_stored(comic, handle, page_index, page) == 0) {
+        return 0;
+    }
+
+    page->buffer = extract_page(comic, handle, page_index, &page->size);
+    if (!page->buffer) {
+        return -1;
+    }
+    page->data = page->buffer;
+    return 0;
+}
+
 unsigned char *comic_extract_page(ComicBook *comic, int page_index, size_t *out_size) {
-    if (!comic->archive_handle || page_index < 0 || page_index >= comic->page_count) {
+    if (comic->handle_count == 0 || page_index < 0 || page_index >= comic->page_count) {
         return NULL;
     }
 
-    switch (comic->format) {
-        case COMIC_FORMAT_CBZ:
-            return cbz_extract_internal(comic, page_index, out_size);
-        case COMIC_FORMAT_CBR:
-            return cbr_extract_internal(comic, page_index, out_size);
-        default:
-            return NULL;
+    ArchiveHandle *handle = acquire_handle(comic);
+    unsigned char *data = extract_page(comic, handle, page_index, out_size);
+    release_handle(comic, handle);
+    return data;
+}
+
+int comic_get_page_data(ComicBook *comic, int page_index, PageData *page) {
+    memset(page, 0, sizeof(PageData));
+    if (comic->handle_count == 0 || page_index < 0 || page_index >= comic->page_count) {
+        return -1;
+    }
+
+    // Views stay valid after release: mappings live until comic_close
+    ArchiveHandle *handle = acquire_handle(comic);
+    int result = get_page_data(comic, handle, page_index, page);
+    release_handle(comic, handle);
+    return result;
+}
+
+SDL_RWops *comic_open_page_rw(ComicBook *comic, int page_index) {
+    if (comic->handle_count == 0 || page_index < 0 || page_index >= comic->page_count) {
+        return NULL;
     }
+
+    PageStream *ps = (PageStream *)calloc(1, sizeof(PageStream));
+    SDL_RWops *rw = SDL_AllocRW();
+    if (!ps || !rw) {
+        free(ps);
+        if (rw) SDL_FreeRW(rw);
+        return NULL;
+    }
+    ps->comic = comic;
+    ps->page_index = page_index;
+
+    ArchiveHandle *handle = acquire_handle(comic);
+    int ok;
+    if (comic->format == COMIC_FORMAT_CBZ && cbz_view_stored(comic, handle, page_index, &ps->data) == 0) {
+        // Stored page: read in place from the mapping
+        ok = 1;
+    } else if (comic->format == COMIC_FORMAT_CBR && comic->solid) {
+        // Solid entries are walked to (and spilled) by the extractor
+        ok = get_page_data(comic, handle, page_index, &ps->data) == 0;
+    } else {
+        // Keep the handle until the decoder is done reading
+        ps->handle = handle;
+        ps->size = comic->pages[page_index].uncompressed_size;
+        ok = page_stream_start(ps) == 0;
+    }
+
+    if (!ps->handle || !ok) {
+        if (ps->handle) page_stream_stop(ps);
+        release_handle(comic, handle);
+        ps->handle = NULL;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to open page: %s\n", comic->pages[page_index].filename);
+        free(ps);
+        SDL_FreeRW(rw);
+        return NULL;
+    }
+    if (ps->data.data) {
+        ps->size = ps->data.size;
+    }
+
+    rw->seek = page_rw_seek;
+    rw->read = page_rw_read;
+    rw->write = page_rw_write;
+    rw->close = page_rw_close;
+    rw->hidden.unknown.data1 = ps;
+    return rw;
+}
+
+void comic_release_page_data(PageData *page) {
+    free(page->buffer);
+    memset(page, 0, sizeof(PageData));
 }
 
 const char *comic_page_name(ComicBook *comic, int page_index) {
@@ -3,10 +3,17 @@
 
 #include <SDL.h>
 #include <stddef.h>
+#include "spill.h"
+#include "iommap.h"
+#include "arena.h"
 
-#define MAX_PAGES 2000
 #define MAX_FILENAME 256
 
+// Solid CBRs keep a decoder checkpoint every few entries, so pages that
+// weren't spilled resume near the target instead of at the first entry
+#define SOLID_CHECKPOINT_INTERVAL 8
+#define SOLID_CHECKPOINT_MAX_BYTES (24 * 1024 * 1024)  // ~4 MB per checkpoint
+
 typedef enum {
     COMIC_FORMAT_UNKNOWN,
     COMIC_FORMAT_CBZ,
@@ -15,22 +22,56 @@ typedef enum {
 
 // Page info (stored in memory, no image data)
 typedef struct {
-    char filename[MAX_FILENAME];
-    unsigned long compressed_size;
-    unsigned long uncompressed_size;
-    long long offset;  // For seeking (CBR)
+    const char *filename;           // Stored in the comic's name arena
+    const unsigned char *sort_key;  // Natural sort key of the basename (arena)
+    unsigned int sort_key_len;
+    unsigned int compressed_size;
+    unsigned int uncompressed_size;
+    long long offset;       // CBR: entry offset, CBZ: central directory offset
+    long long entry_index;  // CBZ: entry number in the central directory
 } PageInfo;
 
+// Open archive handles, enough for every decode worker to have its own
+#define COMIC_MAX_HANDLES 2
+
+// One open instance of the archive. Each has its own read position, so
+// different threads can extract pages at the same time.
+typedef struct {
+    void *archive;              // unzFile or ar_archive
+    void *stream;               // ar_stream backing the ar_archive (CBR)
+    mmap_file_view map;         // CBZ: read-only mapping, data is NULL if not mapped
+    int in_use;
+} ArchiveHandle;
+
 // Comic book handle
 typedef struct {
-    void *archive_handle;       // unzFile or ar_archive
+    ArchiveHandle handles[COMIC_MAX_HANDLES];
+    int handle_count;           // Handles opened so far
+    int handle_limit;           // Max handles to open (1 for solid CBRs)
+    SDL_mutex *handle_lock;
+    SDL_cond *handle_free;      // Signalled when a handle is released
     ComicFormat format;
     char filepath[512];
-    PageInfo pages[MAX_PAGES];
+    PageInfo *pages;            // Grows with the archive, page_capacity entries
     int page_count;
+    int page_capacity;
+    StringArena names;          // Filenames and sort keys of all pages
     int current_page;
+
+    // Solid CBR state: decoded pages are spilled as the stream is walked
+    int solid;                  // 1 if entries depend on earlier ones
+    long long solid_last;       // Offset of the last entry fully decoded, -1 if none
+    SpillStore spill;
 } ComicBook;
 
+// Page image bytes: either a view into the mapped archive (stored CBZ
+// entries) or an extracted copy owned by the PageData
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+    unsigned char *buffer;      // Extracted copy, NULL for a view
+} PageData;
+
 // Open a CBZ/CBR file, read directory, sort pages
 int comic_open(ComicBook *comic, const char *filepath);
 
@@ -44,9 +85,25 @@ int comic_page_count(ComicBook *comic);
 // Returns raw image data (JPEG/PNG bytes)
 unsigned char *comic_extract_page(ComicBook *comic, int page_index, size_t *out_size);
 
+// Get a page's image data without copying it when possible
+// Returns 0 on success, -1 on failure; release with comic_release_page_data
+int comic_get_page_data(ComicBook *comic, int page_index, PageData *page);
+
+// Free a page's extracted copy (views need no cleanup)
+void comic_release_page_data(PageData *page);
+
+// Open a page's image data for reading by the image decoder. Stored CBZ
+// pages are read in place, compressed pages are inflated as they are read.
+// Returns NULL on failure; close with SDL_RWclose (or IMG_Load_RW's freesrc).
+SDL_RWops *comic_open_page_rw(ComicBook *comic, int page_index);
+
 // Get page filename
 const char *comic_page_name(ComicBook *comic, int page_index);
 
+// Append a page to the page table (used while scanning or loading the index)
+// Returns the new page with only its filename and sort key set, NULL if out of memory
+PageInfo *comic_add_page(ComicBook *comic, const char *filename, size_t name_len);
+
 // Legacy names for compatibility
 #define cbz_open comic_open
 #define cbz_close comic_close
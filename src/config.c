@@ -141,6 +141,9 @@ void config_init(AppConfig *config) {
     memset(config, 0, sizeof(AppConfig));
     strcpy(config->current_path, "/");
     config->remember_password = 0;
+    config->cache_budget_mb = DEFAULT_CACHE_BUDGET_MB;
+    config->disk_cache_mb = DEFAULT_DISK_CACHE_MB;
+    config->screen_depth = DEFAULT_SCREEN_DEPTH;
 }
 
 int config_load(AppConfig *config, const char *filepath) {
@@ -175,6 +178,15 @@ int config_load(AppConfig *config, const char *filepath) {
             strncpy(config->password, value, MAX_PASS_LEN - 1);
         } else if (strcmp(key, "remember_password") == 0) {
             config->remember_password = atoi(value);
+        } else if (strcmp(key, "cache_budget_mb") == 0) {
+            int mb = atoi(value);
+            if (mb > 0) config->cache_budget_mb = mb;
+        } else if (strcmp(key, "disk_cache_mb") == 0) {
+            int mb = atoi(value);
+            if (mb >= 0) config->disk_cache_mb = mb;
+        } else if (strcmp(key, "screen_depth") == 0) {
+            int depth = atoi(value);
+            if (depth == 16 || depth == 32) config->screen_depth = depth;
         }
     }
 
@@ -200,6 +212,9 @@ int config_save(const AppConfig *config, const char *filepath) {
     } else {
         fprintf(f, "remember_password=0\n");
     }
+    fprintf(f, "cache_budget_mb=%d\n", config->cache_budget_mb);
+    fprintf(f, "disk_cache_mb=%d\n", config->disk_cache_mb);
+    fprintf(f, "screen_depth=%d\n", config->screen_depth);
 
     fclose(f);
     return 0;
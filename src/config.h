@@ -8,12 +8,19 @@
 #define MAX_PASS_LEN 256
 #define MAX_PATH_LEN 1024
 
+#define DEFAULT_CACHE_BUDGET_MB 32
+#define DEFAULT_DISK_CACHE_MB 256
+#define DEFAULT_SCREEN_DEPTH 32
+
 typedef struct {
     char server_url[MAX_URL_LEN];    // e.g., "https://cloud.example.com"
     char username[MAX_USER_LEN];
     char password[MAX_PASS_LEN];
     char current_path[MAX_PATH_LEN]; // Current browsing path
     int remember_password;           // 1 = save password
+    int cache_budget_mb;             // Memory for decoded pages
+    int disk_cache_mb;               // Flash for decoded pages, 0 = off
+    int screen_depth;                // 32, or 16 for RGB565 pages and screen
 } AppConfig;
 
 // Initialize config with defaults
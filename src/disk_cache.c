@@ -0,0 +1,353 @@
+#include "disk_cache.h"
+#include "scale.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <dirent.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+// Page file layout (native byte order, it never leaves the device):
+//   PageHeader, then the rows without padding as one zlib stream.
+// Pages are stored in the format they're cached in (8-bit grayscale,
+// RGB565 or 24/32-bit), so a page read back needs no converting.
+// Level 1 deflate takes little time on the worker and inflating is much
+// cheaper than decoding the JPEG again; white margins shrink a lot.
+#define PAGE_MAGIC 0x47504352  // "RCPG"
+#define PAGE_VERSION 2
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes_per_pixel;
+    uint32_t gray;          // 1 for 8-bit grayscale (gray ramp palette)
+    uint32_t rmask, gmask, bmask, amask;
+    uint32_t image_width;
+    uint32_t image_height;
+} PageHeader;
+
+// Page file found when scanning the directory
+typedef struct {
+    char name[64];
+    time_t mtime;
+    long long size;
+} PageFile;
+
+// Page files are named after the archive key, page and size asked for;
+// the key changes when the archive does, so stale pages just age out
+static void page_path_for(DiskCache *disk, int page_index, int max_width, int max_height,
+                          char *out, size_t out_len) {
+    snprintf(out, out_len, "%s/%016llx-%d-%dx%d.pg", DISK_CACHE_DIR,
+             disk->key, page_index, max_width, max_height);
+}
+
+static int ends_with(const char *name, const char *suffix) {
+    size_t len = strlen(name);
+    size_t suffix_len = strlen(suffix);
+    return len > suffix_len && strcmp(name + len - suffix_len, suffix) == 0;
+}
+
+static int compare_mtime(const void *a, const void *b) {
+    time_t ta = ((const PageFile *)a)->mtime;
+    time_t tb = ((const PageFile *)b)->mtime;
+    return (ta > tb) - (ta < tb);
+}
+
+// Add up the page files, deleting least recently used ones until they take
+// at most target bytes. Files last touched longest ago go first.
+// (call with lock held)
+static void trim_files(DiskCache *disk, long long target, int remove_tmp) {
+    DIR *dir = opendir(DISK_CACHE_DIR);
+    if (!dir) {
+        disk->used = 0;
+        return;
+    }
+
+    PageFile *files = NULL;
+    int count = 0;
+    int capacity = 0;
+    long long used = 0;
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        char path[320];
+        snprintf(path, sizeof(path), "%s/%s", DISK_CACHE_DIR, ent->d_name);
+
+        // Left behind by a write cut short
+        if (ends_with(ent->d_name, ".tmp")) {
+            if (remove_tmp) remove(path);
+            continue;
+        }
+
+        struct stat st;
+        if (!ends_with(ent->d_name, ".pg") || strlen(ent->d_name) >= sizeof(files->name) ||
+            stat(path, &st) != 0) {
+            continue;
+        }
+
+        if (count == capacity) {
+            int new_capacity = capacity ? capacity * 2 : 64;
+            PageFile *grown = (PageFile *)realloc(files, new_capacity * sizeof(PageFile));
+            if (!grown) break;
+            files = grown;
+            capacity = new_capacity;
+        }
+        strcpy(files[count].name, ent->d_name);
+        files[count].mtime = st.st_mtime;
+        files[count].size = st.st_size;
+        count++;
+        used += st.st_size;
+    }
+    closedir(dir);
+
+    if (used > target) {
+        qsort(files, count, sizeof(PageFile), compare_mtime);
+
+        int evicted = 0;
+        for (int i = 0; i < count && used > target; i++) {
+            char path[320];
+            snprintf(path, sizeof(path), "%s/%s", DISK_CACHE_DIR, files[i].name);
+            if (remove(path) == 0) {
+                used -= files[i].size;
+                evicted++;
+            }
+        }
+        printf("Disk cache: evicted %d pages, %lld KB left\n", evicted, used / 1024);
+    }
+
+    free(files);
+    disk->used = used;
+}
+
+int disk_cache_open(DiskCache *disk, const char *archive_path, long long budget) {
+    memset(disk, 0, sizeof(DiskCache));
+
+    struct stat st;
+    if (budget <= 0 || stat(archive_path, &st) != 0) {
+        return -1;
+    }
+
+    // FNV-1a over the path, then size and mtime so a changed archive misses
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char *p = archive_path; *p; p++) {
+        hash ^= (unsigned char)*p;
+        hash *= 1099511628211ULL;
+    }
+    int64_t identity[2] = {(int64_t)st.st_size, (int64_t)st.st_mtime};
+    const unsigned char *bytes = (const unsigned char *)identity;
+    for (size_t i = 0; i < sizeof(identity); i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    disk->lock = SDL_CreateMutex();
+    if (!disk->lock) {
+        return -1;
+    }
+
+    mkdir("/media/internal/.comic-reader", 0755);
+    mkdir(DISK_CACHE_DIR, 0755);
+
+    disk->key = hash;
+    disk->budget = budget;
+    trim_files(disk, budget, 1);
+    return 0;
+}
+
+void disk_cache_close(DiskCache *disk) {
+    if (disk->lock) {
+        SDL_DestroyMutex(disk->lock);
+    }
+    memset(disk, 0, sizeof(DiskCache));
+}
+
+// Inflate the rows of a page file into surface
+static int read_rows(FILE *f, SDL_Surface *surface) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) {
+        return -1;
+    }
+
+    unsigned char in[16384];
+    int row_bytes = surface->w * surface->format->BytesPerPixel;
+    int ended = 0;
+    int ok = 1;
+
+    SDL_LockSurface(surface);
+    for (int y = 0; ok && y < surface->h; y++) {
+        zs.next_out = (Bytef *)surface->pixels + y * surface->pitch;
+        zs.avail_out = row_bytes;
+
+        while (ok && zs.avail_out > 0) {
+            if (ended) {
+                ok = 0;
+                break;
+            }
+            if (zs.avail_in == 0) {
+                zs.next_in = in;
+                zs.avail_in = fread(in, 1, sizeof(in), f);
+                if (zs.avail_in == 0) {
+                    ok = 0;
+                    break;
+                }
+            }
+
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            if (ret == Z_STREAM_END) {
+                ended = 1;
+            } else if (ret != Z_OK) {
+                ok = 0;
+            }
+        }
+    }
+    SDL_UnlockSurface(surface);
+
+    inflateEnd(&zs);
+    return ok ? 0 : -1;
+}
+
+// Deflate the rows of surface into a page file
+static int write_rows(FILE *f, SDL_Surface *surface) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit(&zs, Z_BEST_SPEED) != Z_OK) {
+        return -1;
+    }
+
+    unsigned char out[16384];
+    int row_bytes = surface->w * surface->format->BytesPerPixel;
+    int ok = 1;
+
+    SDL_LockSurface(surface);
+    for (int y = 0; ok && y < surface->h; y++) {
+        int flush = (y == surface->h - 1) ? Z_FINISH : Z_NO_FLUSH;
+        zs.next_in = (Bytef *)surface->pixels + y * surface->pitch;
+        zs.avail_in = row_bytes;
+
+        // Drain until deflate stops filling the whole output buffer
+        do {
+            zs.next_out = out;
+            zs.avail_out = sizeof(out);
+            deflate(&zs, flush);
+            size_t n = sizeof(out) - zs.avail_out;
+            if (n > 0 && fwrite(out, 1, n, f) != n) {
+                ok = 0;
+            }
+        } while (ok && zs.avail_out == 0);
+    }
+    SDL_UnlockSurface(surface);
+
+    deflateEnd(&zs);
+    return ok ? 0 : -1;
+}
+
+SDL_Surface *disk_cache_get(DiskCache *disk, int page_index, int max_width, int max_height,
+                            int *image_width, int *image_height) {
+    if (disk->budget <= 0) {
+        return NULL;
+    }
+
+    char path[256];
+    page_path_for(disk, page_index, max_width, max_height, path, sizeof(path));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+
+    PageHeader header;
+    SDL_Surface *surface = NULL;
+    if (fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == PAGE_MAGIC &&
+        header.version == PAGE_VERSION &&
+        header.width > 0 && header.width <= (uint32_t)max_width &&
+        header.height > 0 && header.height <= (uint32_t)max_height) {
+        if (header.gray && header.bytes_per_pixel == 1) {
+            surface = SDL_CreateRGBSurface(SDL_SWSURFACE, header.width, header.height, 8, 0, 0, 0, 0);
+            if (surface) set_gray_palette(surface);
+        } else if (!header.gray && header.bytes_per_pixel >= 2 && header.bytes_per_pixel <= 4) {
+            surface = SDL_CreateRGBSurface(SDL_SWSURFACE, header.width, header.height,
+                                           header.bytes_per_pixel * 8, header.rmask,
+                                           header.gmask, header.bmask, header.amask);
+        }
+    }
+    if (surface && read_rows(f, surface) != 0) {
+        SDL_FreeSurface(surface);
+        surface = NULL;
+    }
+    fclose(f);
+
+    if (!surface) {
+        fprintf(stderr, "Dropping unreadable cached page: %s\n", path);
+        remove(path);
+        return NULL;
+    }
+
+    // The file's mtime is its last use for eviction
+    utime(path, NULL);
+
+    *image_width = header.image_width;
+    *image_height = header.image_height;
+    return surface;
+}
+
+int disk_cache_put(DiskCache *disk, int page_index, int max_width, int max_height,
+                   SDL_Surface *surface, int image_width, int image_height) {
+    SDL_PixelFormat *format = surface->format;
+    int gray = is_gray_format(format);
+    if (disk->budget <= 0 || (!gray && (format->palette || format->BytesPerPixel < 2))) {
+        return -1;
+    }
+
+    char path[256];
+    char tmp_path[264];
+    page_path_for(disk, page_index, max_width, max_height, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        fprintf(stderr, "Failed to store page %d: %s\n", page_index, tmp_path);
+        return -1;
+    }
+
+    PageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = PAGE_MAGIC;
+    header.version = PAGE_VERSION;
+    header.width = surface->w;
+    header.height = surface->h;
+    header.bytes_per_pixel = format->BytesPerPixel;
+    header.gray = gray;
+    header.rmask = format->Rmask;
+    header.gmask = format->Gmask;
+    header.bmask = format->Bmask;
+    header.amask = format->Amask;
+    header.image_width = image_width;
+    header.image_height = image_height;
+
+    int ok = fwrite(&header, sizeof(header), 1, f) == 1 && write_rows(f, surface) == 0;
+    if (fclose(f) != 0) ok = 0;
+
+    // Rename into place so readers never see a half-written page
+    struct stat st;
+    if (!ok || stat(tmp_path, &st) != 0 || rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Failed to store page %d: %s\n", page_index, path);
+        remove(tmp_path);
+        return -1;
+    }
+
+    // Trim below the budget so every store doesn't rescan the directory
+    SDL_mutexP(disk->lock);
+    disk->used += st.st_size;
+    if (disk->used > disk->budget) {
+        trim_files(disk, disk->budget - disk->budget / 8, 0);
+    }
+    SDL_mutexV(disk->lock);
+
+    return 0;
+}
@@ -0,0 +1,38 @@
+#ifndef DISK_CACHE_H
+#define DISK_CACHE_H
+
+#include <SDL.h>
+
+// Decoded, already scaled pages are kept on flash so revisiting a page
+// (also after reopening the comic) skips extraction and decoding
+#define DISK_CACHE_DIR "/media/internal/.comic-reader/pages"
+
+typedef struct {
+    unsigned long long key; // Hash of the archive's path, size and mtime
+    long long budget;       // Max bytes of page files, 0 if disabled
+    long long used;         // Bytes of page files in DISK_CACHE_DIR
+    SDL_mutex *lock;        // Decode workers share the cache
+} DiskCache;
+
+// Open the disk cache for an archive, keeping all page files (of every
+// comic) within budget bytes. A budget of 0 disables the cache.
+// Returns 0 on success, -1 on failure (cache stays disabled but safe to call)
+int disk_cache_open(DiskCache *disk, const char *archive_path, long long budget);
+
+// Close the cache, the page files stay
+void disk_cache_close(DiskCache *disk);
+
+// Load a page stored for max_width x max_height and mark it recently used.
+// *image_width/*image_height get what was stored with it.
+// Returns the page surface, or NULL if it isn't stored
+SDL_Surface *disk_cache_get(DiskCache *disk, int page_index, int max_width, int max_height,
+                            int *image_width, int *image_height);
+
+// Store a page scaled for max_width x max_height (24/32-bit, RGB565 or
+// 8-bit grayscale), evicting the least recently used page files once over
+// budget
+// Returns 0 on success, -1 on failure
+int disk_cache_put(DiskCache *disk, int page_index, int max_width, int max_height,
+                   SDL_Surface *surface, int image_width, int image_height);
+
+#endif
@@ -0,0 +1,227 @@
+#include "jpeg_decode.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include <jpeglib.h>
+
+#define JPEG_INPUT_BUFFER 4096
+
+// ============== RWops Source ==============
+
+typedef struct {
+    struct jpeg_source_mgr pub;
+    SDL_RWops *rw;
+    JOCTET buffer[JPEG_INPUT_BUFFER];
+} RWSource;
+
+static void rw_init_source(j_decompress_ptr cinfo) {
+    (void)cinfo;
+}
+
+static boolean rw_fill_input_buffer(j_decompress_ptr cinfo) {
+    RWSource *src = (RWSource *)cinfo->src;
+    int n = SDL_RWread(src->rw, src->buffer, 1, JPEG_INPUT_BUFFER);
+
+    if (n <= 0) {
+        // Truncated file: insert a fake EOI so libjpeg finishes what it has
+        src->buffer[0] = 0xFF;
+        src->buffer[1] = JPEG_EOI;
+        n = 2;
+    }
+
+    src->pub.next_input_byte = src->buffer;
+    src->pub.bytes_in_buffer = n;
+    return TRUE;
+}
+
+static void rw_skip_input_data(j_decompress_ptr cinfo, long num_bytes) {
+    RWSource *src = (RWSource *)cinfo->src;
+    if (num_bytes <= 0) {
+        return;
+    }
+
+    if ((size_t)num_bytes <= src->pub.bytes_in_buffer) {
+        src->pub.next_input_byte += num_bytes;
+        src->pub.bytes_in_buffer -= num_bytes;
+        return;
+    }
+
+    num_bytes -= src->pub.bytes_in_buffer;
+    src->pub.bytes_in_buffer = 0;
+    SDL_RWseek(src->rw, num_bytes, RW_SEEK_CUR);
+}
+
+static void rw_term_source(j_decompress_ptr cinfo) {
+    (void)cinfo;
+}
+
+// ============== Errors ==============
+
+typedef struct {
+    struct jpeg_error_mgr pub;
+    jmp_buf jump;
+} JpegError;
+
+static void jpeg_error_exit(j_common_ptr cinfo) {
+    JpegError *err = (JpegError *)cinfo->err;
+    char message[JMSG_LENGTH_MAX];
+
+    (*cinfo->err->format_message)(cinfo, message);
+    fprintf(stderr, "JPEG decode failed: %s\n", message);
+    longjmp(err->jump, 1);
+}
+
+// ============== Decoding ==============
+
+struct JpegDecoder {
+    struct jpeg_decompress_struct cinfo;
+    JpegError err;
+    RWSource src;
+};
+
+int jpeg_sniff(SDL_RWops *rw) {
+    Uint8 magic[3];
+
+    int n = SDL_RWread(rw, magic, 1, sizeof(magic));
+    SDL_RWseek(rw, 0, RW_SEEK_SET);
+
+    return n == 3 && magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF;
+}
+
+int jpeg_rows_open(JpegRows *rows, SDL_RWops *rw, int fit_width, int fit_height) {
+    memset(rows, 0, sizeof(JpegRows));
+
+    // Kept on the heap, it must stay put between calls
+    struct JpegDecoder *dec = (struct JpegDecoder *)calloc(1, sizeof(struct JpegDecoder));
+    if (!dec) {
+        return -1;
+    }
+    rows->decoder = dec;
+
+    struct jpeg_decompress_struct *cinfo = &dec->cinfo;
+    cinfo->err = jpeg_std_error(&dec->err.pub);
+    dec->err.pub.error_exit = jpeg_error_exit;
+    if (setjmp(dec->err.jump)) {
+        jpeg_rows_close(rows);
+        return -1;
+    }
+
+    jpeg_create_decompress(cinfo);
+
+    dec->src.rw = rw;
+    dec->src.pub.init_source = rw_init_source;
+    dec->src.pub.fill_input_buffer = rw_fill_input_buffer;
+    dec->src.pub.skip_input_data = rw_skip_input_data;
+    dec->src.pub.resync_to_restart = jpeg_resync_to_restart;
+    dec->src.pub.term_source = rw_term_source;
+    cinfo->src = &dec->src.pub;
+
+    jpeg_read_header(cinfo, TRUE);
+
+    // Leave CMYK/YCCK to SDL_image, libjpeg can't convert them to RGB
+    if (cinfo->jpeg_color_space == JCS_CMYK || cinfo->jpeg_color_space == JCS_YCCK) {
+        jpeg_rows_close(rows);
+        return -1;
+    }
+    cinfo->out_color_space = JCS_RGB;
+
+    // Size the image will end up at (same rounding as scale_surface)
+    float scale_x = (float)fit_width / cinfo->image_width;
+    float scale_y = (float)fit_height / cinfo->image_height;
+    float scale = (scale_x < scale_y) ? scale_x : scale_y;
+    if (scale > 1.0f) scale = 1.0f;
+    unsigned int target_w = (unsigned int)(cinfo->image_width * scale);
+    unsigned int target_h = (unsigned int)(cinfo->image_height * scale);
+
+    // Smallest IDCT output that still covers the target
+    cinfo->scale_num = 1;
+    for (unsigned int denom = 8; denom > 1; denom /= 2) {
+        cinfo->scale_denom = denom;
+        jpeg_calc_output_dimensions(cinfo);
+        if (cinfo->output_width >= target_w && cinfo->output_height >= target_h) {
+            break;
+        }
+        cinfo->scale_denom = 1;
+    }
+
+    jpeg_start_decompress(cinfo);
+
+    rows->image_width = cinfo->image_width;
+    rows->image_height = cinfo->image_height;
+    rows->width = cinfo->output_width;
+    rows->height = cinfo->output_height;
+    rows->denom = cinfo->scale_denom;
+    return 0;
+}
+
+int jpeg_rows_read(JpegRows *rows, Uint8 *row) {
+    struct JpegDecoder *dec = rows->decoder;
+
+    if (!dec || rows->y >= rows->height) {
+        return -1;
+    }
+    if (setjmp(dec->err.jump)) {
+        return -1;
+    }
+
+    JSAMPROW sample_row = row;
+    jpeg_read_scanlines(&dec->cinfo, &sample_row, 1);
+    rows->y++;
+    return 0;
+}
+
+void jpeg_rows_close(JpegRows *rows) {
+    struct JpegDecoder *dec = rows->decoder;
+    if (!dec) {
+        return;
+    }
+
+    // Also drops a decode stopped before the last row
+    jpeg_destroy_decompress(&dec->cinfo);
+    free(dec);
+    rows->decoder = NULL;
+}
+
+SDL_Surface *jpeg_load_scaled(SDL_RWops *rw, int fit_width, int fit_height,
+                              int *image_width, int *image_height) {
+    JpegRows rows;
+    if (jpeg_rows_open(&rows, rw, fit_width, fit_height) != 0) {
+        return NULL;
+    }
+    *image_width = rows.image_width;
+    *image_height = rows.image_height;
+
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, rows.width, rows.height, 24,
+                                                0x0000FF, 0x00FF00, 0xFF0000, 0);
+#else
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, rows.width, rows.height, 24,
+                                                0xFF0000, 0x00FF00, 0x0000FF, 0);
+#endif
+    if (!surface) {
+        fprintf(stderr, "Failed to create JPEG surface\n");
+        jpeg_rows_close(&rows);
+        return NULL;
+    }
+
+    // Scanlines go straight into the surface, no intermediate buffer
+    SDL_LockSurface(surface);
+    int ok = 1;
+    while (ok && rows.y < rows.height) {
+        ok = jpeg_rows_read(&rows, (Uint8 *)surface->pixels + rows.y * surface->pitch) == 0;
+    }
+    SDL_UnlockSurface(surface);
+
+    if (ok && rows.denom > 1) {
+        printf("JPEG %dx%d decoded at 1/%d: %dx%d\n", rows.image_width, rows.image_height,
+               rows.denom, rows.width, rows.height);
+    }
+
+    jpeg_rows_close(&rows);
+    if (!ok) {
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+    return surface;
+}
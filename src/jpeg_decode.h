@@ -0,0 +1,41 @@
+#ifndef JPEG_DECODE_H
+#define JPEG_DECODE_H
+
+#include <SDL.h>
+
+// JPEG decoder handing out one RGB row at a time
+typedef struct {
+    int image_width;        // Full size of the JPEG
+    int image_height;
+    int width;              // Size rows are decoded at
+    int height;
+    int denom;              // IDCT scale, 1/denom
+    int y;                  // Next row
+    struct JpegDecoder *decoder;
+} JpegRows;
+
+// Check for the JPEG signature, rewinding rw after
+int jpeg_sniff(SDL_RWops *rw);
+
+// Start decoding rw (rw stays owned by the caller) at the smallest IDCT
+// scale that still covers fitting the image into fit_width x fit_height
+// Returns 0 on success, -1 if the JPEG can't be decoded this way (e.g. CMYK)
+int jpeg_rows_open(JpegRows *rows, SDL_RWops *rw, int fit_width, int fit_height);
+
+// Decode the next row into row (width * 3 bytes)
+// Returns 0 on success, -1 on failure
+int jpeg_rows_read(JpegRows *rows, Uint8 *row);
+
+// Stop decoding, also before the last row
+void jpeg_rows_close(JpegRows *rows);
+
+// Decode a JPEG with libjpeg, letting the IDCT scale it down by 1/2, 1/4
+// or 1/8 as long as the result still covers what fitting the image into
+// fit_width x fit_height needs. The caller scales the rest of the way.
+// *image_width/*image_height are set to the JPEG's full size.
+// Returns a 24-bit RGB surface, or NULL if the JPEG can't be decoded this
+// way (e.g. CMYK); rw is left open and should be rewound for a fallback.
+SDL_Surface *jpeg_load_scaled(SDL_RWops *rw, int fit_width, int fit_height,
+                              int *image_width, int *image_height);
+
+#endif
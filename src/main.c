@@ -16,7 +16,7 @@ static UIState ui;
 
 int main(int argc, char *argv[]) {
     // Initialize SDL
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
         fprintf(stderr, "SDL_Init failed: %s\n", SDL_GetError());
         return 1;
     }
@@ -48,11 +48,17 @@ int main(int argc, char *argv[]) {
         ui_scan_directory(&ui, DEFAULT_DIR);
     }
 
-    // Main loop
+    // Main loop: sleep until input, a decoded page or the sensor timer comes
+    // in, handle everything queued, then draw what changed
     int running = 1;
     while (running) {
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        if (!SDL_WaitEvent(&event)) {
+            fprintf(stderr, "SDL_WaitEvent failed: %s\n", SDL_GetError());
+            break;
+        }
+
+        do {
             int result = ui_handle_event(&ui, &event);
 
             switch (result) {
@@ -142,13 +148,12 @@ int main(int argc, char *argv[]) {
                     }
                     break;
             }
-        }
+        } while (running && SDL_PollEvent(&event));
 
         // Poll orientation sensor (updates ui.orientation)
         ui_poll_orientation(&ui);
 
         ui_render(&ui);
-        SDL_Delay(16); // ~60 FPS
     }
 
     // Cleanup
@@ -0,0 +1,162 @@
+#include "png_decode.h"
+#include "scale.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <png.h>
+
+static void png_rw_read(png_structp png, png_bytep data, png_size_t length) {
+    SDL_RWops *rw = (SDL_RWops *)png_get_io_ptr(png);
+    if (SDL_RWread(rw, data, 1, length) != (int)length) {
+        png_error(png, "Read error");
+    }
+}
+
+int png_sniff(SDL_RWops *rw) {
+    Uint8 magic[8];
+
+    int n = SDL_RWread(rw, magic, 1, sizeof(magic));
+    SDL_RWseek(rw, 0, RW_SEEK_SET);
+
+    return n == 8 && png_sig_cmp(magic, 0, 8) == 0;
+}
+
+int png_rows_open(PngRows *rows, SDL_RWops *rw) {
+    memset(rows, 0, sizeof(PngRows));
+
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    png_infop info = png ? png_create_info_struct(png) : NULL;
+    if (!png || !info) {
+        png_destroy_read_struct(&png, &info, NULL);
+        return -1;
+    }
+    rows->png = png;
+    rows->info = info;
+
+    // libpng reports errors by longjmp'ing back here
+    if (setjmp(png_jmpbuf(png))) {
+        png_rows_close(rows);
+        return -1;
+    }
+
+    png_set_read_fn(png, rw, png_rw_read);
+    png_read_info(png, info);
+
+    png_uint_32 width, height;
+    int bit_depth, color_type, interlace;
+    png_get_IHDR(png, info, &width, &height, &bit_depth, &color_type, &interlace, NULL, NULL);
+
+    // Adam7 rows only complete on the last pass, leave those to SDL_image
+    if (interlace != PNG_INTERLACE_NONE) {
+        png_rows_close(rows);
+        return -1;
+    }
+
+    // Everything becomes 8-bit RGB; alpha is dropped like SDL_DisplayFormat does
+    if (bit_depth == 16) png_set_strip_16(png);
+    if (color_type == PNG_COLOR_TYPE_PALETTE) png_set_palette_to_rgb(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) png_set_expand_gray_1_2_4_to_8(png);
+    if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        png_set_gray_to_rgb(png);
+    }
+    if (color_type & PNG_COLOR_MASK_ALPHA) png_set_strip_alpha(png);
+    png_read_update_info(png, info);
+
+    if (png_get_rowbytes(png, info) != width * 3) {
+        png_error(png, "Unexpected row layout");
+    }
+
+    rows->width = width;
+    rows->height = height;
+    return 0;
+}
+
+int png_rows_read(PngRows *rows, Uint8 *row) {
+    png_structp png = (png_structp)rows->png;
+
+    if (!png || rows->y >= rows->height) {
+        return -1;
+    }
+    if (setjmp(png_jmpbuf(png))) {
+        return -1;
+    }
+
+    png_read_row(png, row, NULL);
+    rows->y++;
+    return 0;
+}
+
+void png_rows_close(PngRows *rows) {
+    png_structp png = (png_structp)rows->png;
+    png_infop info = (png_infop)rows->info;
+
+    // Trailing chunks (text, time) aren't needed, skip png_read_end
+    png_destroy_read_struct(&png, &info, NULL);
+    rows->png = NULL;
+    rows->info = NULL;
+}
+
+SDL_Surface *png_load_scaled(SDL_RWops *rw, int fit_width, int fit_height,
+                             int *image_width, int *image_height) {
+    PngRows rows;
+    if (png_rows_open(&rows, rw) != 0) {
+        return NULL;
+    }
+    *image_width = rows.width;
+    *image_height = rows.height;
+
+    // Same fit and rounding as scale_surface
+    float scale_x = (float)fit_width / rows.width;
+    float scale_y = (float)fit_height / rows.height;
+    float scale = (scale_x < scale_y) ? scale_x : scale_y;
+    if (scale > 1.0f) scale = 1.0f;
+    int dst_w = (int)(rows.width * scale);
+    int dst_h = (int)(rows.height * scale);
+    if (dst_w < 1) dst_w = 1;
+    if (dst_h < 1) dst_h = 1;
+
+    RowScaler sc;
+    Uint8 *row = (Uint8 *)malloc(rows.width * 3);
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, dst_w, dst_h, 24,
+                                                0x0000FF, 0x00FF00, 0xFF0000, 0);
+#else
+    SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, dst_w, dst_h, 24,
+                                                0xFF0000, 0x00FF00, 0x0000FF, 0);
+#endif
+    if (row_scaler_init(&sc, rows.width, rows.height, dst_w, dst_h) != 0 || !row || !surface) {
+        fprintf(stderr, "Out of memory decoding PNG\n");
+        row_scaler_free(&sc);
+        free(row);
+        if (surface) SDL_FreeSurface(surface);
+        png_rows_close(&rows);
+        return NULL;
+    }
+
+    // Each source row is summed into the destination row it falls in,
+    // which is written out once its last source row is in
+    SDL_LockSurface(surface);
+    int ok = 1;
+    for (int y = 0; ok && y < rows.height; y++) {
+        int dst_y = row_scaler_dst_row(&sc);
+        const Uint8 *out;
+
+        ok = png_rows_read(&rows, row) == 0;
+        if (ok && (out = row_scaler_push(&sc, row))) {
+            memcpy((Uint8 *)surface->pixels + dst_y * surface->pitch, out, dst_w * 3);
+        }
+    }
+    SDL_UnlockSurface(surface);
+
+    row_scaler_free(&sc);
+    free(row);
+    png_rows_close(&rows);
+
+    if (!ok) {
+        SDL_FreeSurface(surface);
+        return NULL;
+    }
+
+    printf("PNG %dx%d decoded to %dx%d\n", rows.width, rows.height, dst_w, dst_h);
+    return surface;
+}
@@ -0,0 +1,39 @@
+#ifndef PNG_DECODE_H
+#define PNG_DECODE_H
+
+#include <SDL.h>
+
+// PNG decoder handing out one 8-bit RGB row at a time
+typedef struct {
+    int width;              // Image size
+    int height;
+    int y;                  // Next row
+    void *png;              // libpng read and info structs
+    void *info;
+} PngRows;
+
+// Check for the PNG signature, rewinding rw after
+int png_sniff(SDL_RWops *rw);
+
+// Start decoding rw (rw stays owned by the caller)
+// Returns 0 on success, -1 if the PNG can't be decoded this way (e.g.
+// interlaced); rw should then be rewound for a fallback
+int png_rows_open(PngRows *rows, SDL_RWops *rw);
+
+// Decode the next row into row (width * 3 bytes)
+// Returns 0 on success, -1 on failure
+int png_rows_read(PngRows *rows, Uint8 *row);
+
+// Stop decoding, also before the last row
+void png_rows_close(PngRows *rows);
+
+// Decode a PNG with libpng one row at a time, box-filtering rows into the
+// size that fits fit_width x fit_height as they arrive (never upscales).
+// Only a source row and one row of sums are held besides the result.
+// *image_width/*image_height are set to the PNG's full size.
+// Returns a 24-bit RGB surface, or NULL if the PNG can't be decoded this
+// way (e.g. interlaced); rw is left open and should be rewound for a fallback.
+SDL_Surface *png_load_scaled(SDL_RWops *rw, int fit_width, int fit_height,
+                             int *image_width, int *image_height);
+
+#endif
@@ -0,0 +1,530 @@
+#include "rotate.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ROTATE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define ROTATE_SSE2
+#endif
+
+// A block is B source rows of B pixels; dst row i gets source column i.
+// Rows are reached through a byte step that may be negative, which is how
+// the two rotations flip the block.
+
+// 4x4 block of 32-bit pixels
+static void transpose_4x4_32(const Uint8 *src, int src_step, Uint8 *dst, int dst_step) {
+#if defined(ROTATE_NEON)
+    uint32x4_t r0 = vld1q_u32((const uint32_t *)src);
+    uint32x4_t r1 = vld1q_u32((const uint32_t *)(src + src_step));
+    uint32x4_t r2 = vld1q_u32((const uint32_t *)(src + 2 * src_step));
+    uint32x4_t r3 = vld1q_u32((const uint32_t *)(src + 3 * src_step));
+
+    // a0 b0 a2 b2 | a1 b1 a3 b3, then pair up the halves
+    uint32x4x2_t t01 = vtrnq_u32(r0, r1);
+    uint32x4x2_t t23 = vtrnq_u32(r2, r3);
+
+    vst1q_u32((uint32_t *)dst,
+              vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+    vst1q_u32((uint32_t *)(dst + dst_step),
+              vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+    vst1q_u32((uint32_t *)(dst + 2 * dst_step),
+              vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+    vst1q_u32((uint32_t *)(dst + 3 * dst_step),
+              vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+#elif defined(ROTATE_SSE2)
+    __m128i r0 = _mm_loadu_si128((const __m128i *)src);
+    __m128i r1 = _mm_loadu_si128((const __m128i *)(src + src_step));
+    __m128i r2 = _mm_loadu_si128((const __m128i *)(src + 2 * src_step));
+    __m128i r3 = _mm_loadu_si128((const __m128i *)(src + 3 * src_step));
+
+    // a0 b0 a1 b1 | c0 d0 c1 d1 | a2 b2 a3 b3 | c2 d2 c3 d3
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + dst_step), _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *)(dst + 2 * dst_step), _mm_unpacklo_epi64(t2, t3));
+    _mm_storeu_si128((__m128i *)(dst + 3 * dst_step), _mm_unpackhi_epi64(t2, t3));
+#else
+    for (int i = 0; i < 4; i++) {
+        Uint32 *out = (Uint32 *)(dst + i * dst_step);
+        for (int j = 0; j < 4; j++) {
+            out[j] = ((const Uint32 *)(src + j * src_step))[i];
+        }
+    }
+#endif
+}
+
+// 8x8 block of 16-bit pixels
+static void transpose_8x8_16(const Uint8 *src, int src_step, Uint8 *dst, int dst_step) {
+#if defined(ROTATE_NEON)
+    uint16x8_t r[8];
+    for (int j = 0; j < 8; j++) {
+        r[j] = vld1q_u16((const uint16_t *)(src + j * src_step));
+    }
+
+    // Pairs of rows, then pairs of pairs: columns 0|4, 2|6, 1|5 and 3|7
+    // of rows 0-3 and 4-7
+    uint16x8x2_t t01 = vtrnq_u16(r[0], r[1]);
+    uint16x8x2_t t23 = vtrnq_u16(r[2], r[3]);
+    uint16x8x2_t t45 = vtrnq_u16(r[4], r[5]);
+    uint16x8x2_t t67 = vtrnq_u16(r[6], r[7]);
+    uint32x4x2_t even_lo = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]),
+                                     vreinterpretq_u32_u16(t23.val[0]));
+    uint32x4x2_t odd_lo = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]),
+                                    vreinterpretq_u32_u16(t23.val[1]));
+    uint32x4x2_t even_hi = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]),
+                                     vreinterpretq_u32_u16(t67.val[0]));
+    uint32x4x2_t odd_hi = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]),
+                                    vreinterpretq_u32_u16(t67.val[1]));
+
+    uint32x4_t cols[8];
+    cols[0] = vcombine_u32(vget_low_u32(even_lo.val[0]), vget_low_u32(even_hi.val[0]));
+    cols[4] = vcombine_u32(vget_high_u32(even_lo.val[0]), vget_high_u32(even_hi.val[0]));
+    cols[2] = vcombine_u32(vget_low_u32(even_lo.val[1]), vget_low_u32(even_hi.val[1]));
+    cols[6] = vcombine_u32(vget_high_u32(even_lo.val[1]), vget_high_u32(even_hi.val[1]));
+    cols[1] = vcombine_u32(vget_low_u32(odd_lo.val[0]), vget_low_u32(odd_hi.val[0]));
+    cols[5] = vcombine_u32(vget_high_u32(odd_lo.val[0]), vget_high_u32(odd_hi.val[0]));
+    cols[3] = vcombine_u32(vget_low_u32(odd_lo.val[1]), vget_low_u32(odd_hi.val[1]));
+    cols[7] = vcombine_u32(vget_high_u32(odd_lo.val[1]), vget_high_u32(odd_hi.val[1]));
+
+    for (int i = 0; i < 8; i++) {
+        vst1q_u16((uint16_t *)(dst + i * dst_step), vreinterpretq_u16_u32(cols[i]));
+    }
+#elif defined(ROTATE_SSE2)
+    __m128i r[8];
+    for (int j = 0; j < 8; j++) {
+        r[j] = _mm_loadu_si128((const __m128i *)(src + j * src_step));
+    }
+
+    // Interleave pairs of rows, then pairs of pairs: columns 0-1, 2-3,
+    // 4-5 and 6-7 of rows 0-3 and 4-7
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a2 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a3 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a4 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a5 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a6 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a1);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a1);
+    __m128i b2 = _mm_unpacklo_epi32(a2, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a2, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a5);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a5);
+    __m128i b6 = _mm_unpacklo_epi32(a6, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a6, a7);
+
+    _mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi64(b0, b2));
+    _mm_storeu_si128((__m128i *)(dst + dst_step), _mm_unpackhi_epi64(b0, b2));
+    _mm_storeu_si128((__m128i *)(dst + 2 * dst_step), _mm_unpacklo_epi64(b1, b3));
+    _mm_storeu_si128((__m128i *)(dst + 3 * dst_step), _mm_unpackhi_epi64(b1, b3));
+    _mm_storeu_si128((__m128i *)(dst + 4 * dst_step), _mm_unpacklo_epi64(b4, b6));
+    _mm_storeu_si128((__m128i *)(dst + 5 * dst_step), _mm_unpackhi_epi64(b4, b6));
+    _mm_storeu_si128((__m128i *)(dst + 6 * dst_step), _mm_unpacklo_epi64(b5, b7));
+    _mm_storeu_si128((__m128i *)(dst + 7 * dst_step), _mm_unpackhi_epi64(b5, b7));
+#else
+    for (int i = 0; i < 8; i++) {
+        Uint16 *out = (Uint16 *)(dst + i * dst_step);
+        for (int j = 0; j < 8; j++) {
+            out[j] = ((const Uint16 *)(src + j * src_step))[i];
+        }
+    }
+#endif
+}
+
+// Where the source of a rotated area is: dst(x,y) comes from the pixel at
+// pixels + origin + x * x_step + y * y_step, where (x_step, y_step) is
+// (-pitch, bpp) clockwise and (pitch, -bpp) counterclockwise. The origin
+// may lie outside the source; only pixels inside it are read.
+typedef struct {
+    const Uint8 *pixels;
+    long origin;
+    int x_step;
+    int y_step;
+} RotateSource;
+
+static const Uint8 *source_pixel(const RotateSource *src, int x, int y) {
+    return src->pixels + (src->origin + (long)x * src->x_step + (long)y * src->y_step);
+}
+
+// Rotate dst pixels x0..x1-1, y0..y1-1 one at a time, each dst row
+// walking a source column
+static void rotate_pixels(const RotateSource *src, SDL_Surface *dst, int bpp,
+                          int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; y++) {
+        const Uint8 *in = source_pixel(src, x0, y);
+        int step = src->x_step;
+        Uint8 *out = (Uint8 *)dst->pixels + y * dst->pitch + x0 * bpp;
+
+        if (bpp == 2) {
+            for (int x = x0; x < x1; x++, in += step, out += 2) {
+                *(Uint16 *)out = *(const Uint16 *)in;
+            }
+        } else if (bpp == 4) {
+            for (int x = x0; x < x1; x++, in += step, out += 4) {
+                *(Uint32 *)out = *(const Uint32 *)in;
+            }
+        } else {
+            for (int x = x0; x < x1; x++, in += step, out += bpp) {
+                memcpy(out, in, bpp);
+            }
+        }
+    }
+}
+
+// Rotate into dst pixels x0..x1-1, y0..y1-1 (already clipped, surfaces locked)
+static void rotate_area(const RotateSource *src, SDL_Surface *dst, int bpp,
+                        int x0, int y0, int x1, int y1) {
+    int block = (bpp == 2) ? 8 : (bpp == 4) ? 4 : 0;
+    if (block == 0) {
+        rotate_pixels(src, dst, bpp, x0, y0, x1, y1);
+        return;
+    }
+
+    // Whole blocks, a tile at a time; the ragged right and bottom edges
+    // are left to rotate_pixels
+    int clockwise = src->y_step > 0;
+    int bx1 = x0 + (x1 - x0) / block * block;
+    int by1 = y0 + (y1 - y0) / block * block;
+    int dst_pitch = dst->pitch;
+
+    for (int ty = y0; ty < by1; ty += ROTATE_TILE) {
+        int ty1 = (ty + ROTATE_TILE < by1) ? ty + ROTATE_TILE : by1;
+        for (int tx = x0; tx < bx1; tx += ROTATE_TILE) {
+            int tx1 = (tx + ROTATE_TILE < bx1) ? tx + ROTATE_TILE : bx1;
+
+            for (int y = ty; y < ty1; y += block) {
+                for (int x = tx; x < tx1; x += block) {
+                    const Uint8 *in;
+                    Uint8 *out;
+                    int out_step;
+                    if (clockwise) {
+                        // Source rows bottom up, dst rows in order
+                        in = source_pixel(src, x, y);
+                        out = (Uint8 *)dst->pixels + y * dst_pitch + x * bpp;
+                        out_step = dst_pitch;
+                    } else {
+                        // Source rows in order, dst rows bottom up
+                        in = source_pixel(src, x, y + block - 1);
+                        out = (Uint8 *)dst->pixels + (y + block - 1) * dst_pitch + x * bpp;
+                        out_step = -dst_pitch;
+                    }
+
+                    if (bpp == 2) {
+                        transpose_8x8_16(in, src->x_step, out, out_step);
+                    } else {
+                        transpose_4x4_32(in, src->x_step, out, out_step);
+                    }
+                }
+            }
+        }
+    }
+
+    if (bx1 < x1) rotate_pixels(src, dst, bpp, bx1, y0, x1, y1);
+    if (by1 < y1) rotate_pixels(src, dst, bpp, x0, by1, bx1, y1);
+}
+
+void rotate_90(SDL_Surface *src, SDL_Surface *dst, int clockwise, const SDL_Rect *area) {
+    int bpp = src->format->BytesPerPixel;
+    int cols = (dst->w < src->h) ? dst->w : src->h;
+    int rows = (dst->h < src->w) ? dst->h : src->w;
+
+    int x0 = 0, y0 = 0, x1 = cols, y1 = rows;
+    if (area) {
+        if (area->x > x0) x0 = area->x;
+        if (area->y > y0) y0 = area->y;
+        if (area->x + area->w < x1) x1 = area->x + area->w;
+        if (area->y + area->h < y1) y1 = area->y + area->h;
+    }
+    if (x1 <= x0 || y1 <= y0 || bpp != dst->format->BytesPerPixel) {
+        return;
+    }
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+
+    RotateSource from;
+    from.pixels = (const Uint8 *)src->pixels;
+    if (clockwise) {
+        from.origin = (long)(src->h - 1) * src->pitch;
+        from.x_step = -src->pitch;
+        from.y_step = bpp;
+    } else {
+        from.origin = (long)(src->w - 1) * bpp;
+        from.x_step = src->pitch;
+        from.y_step = -bpp;
+    }
+    rotate_area(&from, dst, bpp, x0, y0, x1, y1);
+
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+}
+
+const char *rotate_kernel_name(void) {
+#if defined(ROTATE_NEON)
+    return "NEON";
+#elif defined(ROTATE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+// Clip rect to clip; returns 0 if nothing is left
+static int clip_rect(SDL_Rect *rect, const SDL_Rect *clip) {
+    int x0 = (rect->x > clip->x) ? rect->x : clip->x;
+    int y0 = (rect->y > clip->y) ? rect->y : clip->y;
+    int x1 = (rect->x + rect->w < clip->x + clip->w) ? rect->x + rect->w : clip->x + clip->w;
+    int y1 = (rect->y + rect->h < clip->y + clip->h) ? rect->y + rect->h : clip->y + clip->h;
+    if (x1 <= x0 || y1 <= y0) {
+        rect->w = rect->h = 0;
+        return 0;
+    }
+    rect->x = x0;
+    rect->y = y0;
+    rect->w = x1 - x0;
+    rect->h = y1 - y0;
+    return 1;
+}
+
+void view_init(View *view, SDL_Surface *surface, int rotation, const SDL_Rect *clip) {
+    view->surface = surface;
+    view->rotation = rotation;
+    view->w = rotation ? surface->h : surface->w;
+    view->h = rotation ? surface->w : surface->h;
+    view->clip.x = 0;
+    view->clip.y = 0;
+    view->clip.w = view->w;
+    view->clip.h = view->h;
+    if (clip) {
+        clip_rect(&view->clip, clip);
+    }
+    view->lut_ready = 0;
+}
+
+void view_rect_on_surface(const View *view, const SDL_Rect *rect, SDL_Rect *out) {
+    if (view->rotation == 0) {
+        *out = *rect;
+        return;
+    }
+    if (view->rotation == 1) {
+        // view(x,y) → surface(y, w-1-x)
+        out->x = rect->y;
+        out->y = view->w - rect->x - rect->w;
+    } else {
+        // view(x,y) → surface(h-1-y, x)
+        out->x = view->h - rect->y - rect->h;
+        out->y = rect->x;
+    }
+    out->w = rect->h;
+    out->h = rect->w;
+}
+
+// Surface address of view pixel (x, y), and the byte steps to the next
+// pixel along x and y
+static Uint8 *view_pixel(const View *view, int x, int y, int *x_step, int *y_step) {
+    SDL_Surface *s = view->surface;
+    int bpp = s->format->BytesPerPixel;
+    Uint8 *pixels = (Uint8 *)s->pixels;
+
+    if (view->rotation == 0) {
+        *x_step = bpp;
+        *y_step = s->pitch;
+        return pixels + y * s->pitch + x * bpp;
+    }
+    if (view->rotation == 1) {
+        *x_step = -s->pitch;
+        *y_step = bpp;
+        return pixels + (view->w - 1 - x) * s->pitch + y * bpp;
+    }
+    *x_step = s->pitch;
+    *y_step = -bpp;
+    return pixels + x * s->pitch + (view->h - 1 - y) * bpp;
+}
+
+void view_fill(View *view, const SDL_Rect *rect, Uint32 color) {
+    SDL_Rect area = *rect;
+    if (!clip_rect(&area, &view->clip)) {
+        return;
+    }
+    SDL_Rect out;
+    view_rect_on_surface(view, &area, &out);
+    SDL_FillRect(view->surface, &out, color);
+}
+
+// Draw n pixels, the k-th from rows[k * row_inc] + cols[k * col_inc] to
+// dst + k * dst_step. Spans run along the surface's rows, so in a rotated
+// view they walk a source column.
+static void draw_span(View *view, int bpp, Uint8 *dst, int dst_step,
+                      Uint8 *const *rows, int row_inc, const int *cols, int col_inc, int n) {
+    int dst_bpp = view->surface->format->BytesPerPixel;
+
+    if (bpp == 4 && dst_bpp == 4) {
+        for (int k = 0; k < n; k++, dst += dst_step, rows += row_inc, cols += col_inc) {
+            *(Uint32 *)dst = *(const Uint32 *)(*rows + *cols);
+        }
+    } else if (bpp == 2 && dst_bpp == 2) {
+        for (int k = 0; k < n; k++, dst += dst_step, rows += row_inc, cols += col_inc) {
+            *(Uint16 *)dst = *(const Uint16 *)(*rows + *cols);
+        }
+    } else if (bpp == 1 && dst_bpp == 4) {
+        const Uint32 *lut = view->lut;
+        for (int k = 0; k < n; k++, dst += dst_step, rows += row_inc, cols += col_inc) {
+            *(Uint32 *)dst = lut[*(*rows + *cols)];
+        }
+    } else if (bpp == 1 && dst_bpp == 2) {
+        const Uint32 *lut = view->lut;
+        for (int k = 0; k < n; k++, dst += dst_step, rows += row_inc, cols += col_inc) {
+            *(Uint16 *)dst = (Uint16)lut[*(*rows + *cols)];
+        }
+    } else if (bpp >= 3 && dst_bpp >= 3) {
+        for (int k = 0; k < n; k++, dst += dst_step, rows += row_inc, cols += col_inc) {
+            const Uint8 *src = *rows + *cols;
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+        }
+    }
+}
+
+void view_blit_mapped(View *view, SDL_Surface *src, const int *xmap, const int *ymap,
+                      int x, int y, int w, int h) {
+    SDL_Rect area = {x, y, w, h};
+    if (w <= 0 || h <= 0 || !clip_rect(&area, &view->clip)) {
+        return;
+    }
+
+    int bpp = src->format->BytesPerPixel;
+    if (bpp == 1 && !view->lut_ready) {
+        // Grayscale pages: surface pixel of each gray level
+        for (int i = 0; i < 256; i++) {
+            view->lut[i] = SDL_MapRGB(view->surface->format, i, i, i);
+        }
+        view->lut_ready = 1;
+    }
+
+    // Source row of each view row and byte offset of each view column
+    Uint8 **rows = (Uint8 **)malloc(area.h * sizeof(Uint8 *));
+    int *cols = (int *)malloc(area.w * sizeof(int));
+    if (!rows || !cols) {
+        free(rows);
+        free(cols);
+        return;
+    }
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(view->surface);
+
+    for (int j = 0; j < area.h; j++) {
+        rows[j] = (Uint8 *)src->pixels + ymap[area.y - y + j] * src->pitch;
+    }
+    for (int i = 0; i < area.w; i++) {
+        cols[i] = xmap[area.x - x + i] * bpp;
+    }
+
+    int x_step, y_step;
+    if (view->rotation == 0) {
+        for (int j = 0; j < area.h; j++) {
+            Uint8 *dst = view_pixel(view, area.x, area.y + j, &x_step, &y_step);
+            draw_span(view, bpp, dst, x_step, &rows[j], 0, cols, 1, area.w);
+        }
+    } else {
+        // View columns are surface rows: go a tile at a time so the source
+        // rows a column walks stay cached for the columns next to it
+        for (int ty = 0; ty < area.h; ty += ROTATE_TILE) {
+            int n = (area.h - ty < ROTATE_TILE) ? area.h - ty : ROTATE_TILE;
+            for (int i = 0; i < area.w; i++) {
+                Uint8 *dst = view_pixel(view, area.x + i, area.y + ty, &x_step, &y_step);
+                draw_span(view, bpp, dst, y_step, &rows[ty], 1, &cols[i], 0, n);
+            }
+        }
+    }
+
+    SDL_UnlockSurface(view->surface);
+    SDL_UnlockSurface(src);
+
+    free(rows);
+    free(cols);
+}
+
+void view_blit(View *view, SDL_Surface *src, const SDL_Rect *src_rect, int x, int y) {
+    // Part of src to copy, kept within src
+    SDL_Rect from = {0, 0, src->w, src->h};
+    if (src_rect) {
+        from = *src_rect;
+        if (from.x < 0) {
+            x -= from.x;
+            from.w += from.x;
+            from.x = 0;
+        }
+        if (from.y < 0) {
+            y -= from.y;
+            from.h += from.y;
+            from.y = 0;
+        }
+        SDL_Rect whole = {0, 0, src->w, src->h};
+        if (!clip_rect(&from, &whole)) {
+            return;
+        }
+    }
+
+    if (view->rotation == 0) {
+        // SDL clips to the surface's clip rect; make that the view's
+        SDL_Rect old_clip;
+        SDL_Rect dest = {x, y, 0, 0};
+        SDL_GetClipRect(view->surface, &old_clip);
+        SDL_SetClipRect(view->surface, &view->clip);
+        SDL_BlitSurface(src, &from, view->surface, &dest);
+        SDL_SetClipRect(view->surface, &old_clip);
+        return;
+    }
+
+    SDL_Rect area = {x, y, from.w, from.h};
+    if (!clip_rect(&area, &view->clip)) {
+        return;
+    }
+
+    int bpp = src->format->BytesPerPixel;
+    if (bpp != view->surface->format->BytesPerPixel || (bpp != 2 && bpp != 4)) {
+        // Converting pixels: a mapped blit at scale 1
+        int *map = (int *)malloc((area.w + area.h) * sizeof(int));
+        if (!map) {
+            return;
+        }
+        for (int i = 0; i < area.w; i++) map[i] = from.x + area.x - x + i;
+        for (int j = 0; j < area.h; j++) map[area.w + j] = from.y + area.y - y + j;
+        view_blit_mapped(view, src, map, map + area.w, area.x, area.y, area.w, area.h);
+        free(map);
+        return;
+    }
+
+    // Same format: rotate straight from src. View pixel (vx, vy) is src
+    // pixel (from.x + vx - x, from.y + vy - y); fold in the view rotation
+    RotateSource source;
+    source.pixels = (const Uint8 *)src->pixels;
+    if (view->rotation == 1) {
+        source.origin = (long)(from.y - y) * src->pitch + (long)(from.x - x + view->w - 1) * bpp;
+        source.x_step = src->pitch;
+        source.y_step = -bpp;
+    } else {
+        source.origin = (long)(from.y - y + view->h - 1) * src->pitch + (long)(from.x - x) * bpp;
+        source.x_step = -src->pitch;
+        source.y_step = bpp;
+    }
+
+    SDL_Rect out;
+    view_rect_on_surface(view, &area, &out);
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(view->surface);
+    rotate_area(&source, view->surface, bpp, out.x, out.y, out.x + out.w, out.y + out.h);
+    SDL_UnlockSurface(view->surface);
+    SDL_UnlockSurface(src);
+}
@@ -0,0 +1,55 @@
+#ifndef ROTATE_H
+#define ROTATE_H
+
+#include <SDL.h>
+
+// Portrait frames are laid out on a 768x1024 view shown rotated on the
+// 1024x768 screen. Rotation goes in small blocks that are transposed in
+// registers, so both sides are walked along their rows.
+
+// Pixels per side of the tiles the area is rotated in; a tile of source
+// and destination stays in the L1 cache
+#define ROTATE_TILE 32
+
+// Rotate src by 90 degrees into area of dst (dst coordinates, NULL for
+// all of it). dst is src->h x src->w in the same pixel format.
+//   clockwise = 0: dst(x,y) = src(src->w-1-y, x)
+//   clockwise = 1: dst(x,y) = src(y, src->h-1-x)
+// 16 and 32 bpp go through the block kernels, other depths pixel by pixel.
+void rotate_90(SDL_Surface *src, SDL_Surface *dst, int clockwise, const SDL_Rect *area);
+
+// Name of the kernels compiled in ("NEON", "SSE2" or "scalar")
+const char *rotate_kernel_name(void);
+
+// Something to draw pages into: a surface as is, or a portrait view of
+// it with the rotation folded into the drawing, so pages go straight to
+// the screen without an intermediate surface
+typedef struct {
+    SDL_Surface *surface;   // Surface the pixels end up in
+    int rotation;           // 0 = none, 1 = 90° CCW, 2 = 90° CW (as rotate_90)
+    int w;                  // View size (surface size swapped when rotated)
+    int h;
+    SDL_Rect clip;          // Only this part of the view is drawn to
+    Uint32 lut[256];        // Surface pixel of each gray level, for 8-bit pages
+    int lut_ready;
+} View;
+
+// Set up a view of surface, drawing only within clip (view coordinates,
+// NULL for all of it)
+void view_init(View *view, SDL_Surface *surface, int rotation, const SDL_Rect *clip);
+
+// Part of the surface a rectangle of the view lands on
+void view_rect_on_surface(const View *view, const SDL_Rect *rect, SDL_Rect *out);
+
+// Fill a rectangle of the view with a surface pixel value
+void view_fill(View *view, const SDL_Rect *rect, Uint32 color);
+
+// Copy src_rect of src (NULL for all of it) to (x, y) of the view
+void view_blit(View *view, SDL_Surface *src, const SDL_Rect *src_rect, int x, int y);
+
+// Draw w x h pixels at (x, y) of the view, pixel (x+i, y+j) coming from
+// src pixel (xmap[i], ymap[j]); how pages are scaled nearest neighbour
+void view_blit_mapped(View *view, SDL_Surface *src, const int *xmap, const int *ymap,
+                      int x, int y, int w, int h);
+
+#endif
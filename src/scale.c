@@ -0,0 +1,654 @@
+#include "scale.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define SCALE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define SCALE_SSE2
+#endif
+
+// Filter weights are 8-bit fixed point summing to SCALE_ONE per output
+// pixel, so a vertically filtered channel fits in 16 bits (255 * 256)
+// and a filtered pixel in 32 bits after the horizontal pass
+#define SCALE_BITS 8
+#define SCALE_ONE (1 << SCALE_BITS)
+
+// Source pixels covering each destination pixel along one axis
+typedef struct {
+    int *start;         // First source pixel
+    int *count;         // Number of source pixels
+    Uint16 *weights;    // Coverage of each, max_count per destination pixel
+    int max_count;
+} ScaleFilter;
+
+static void filter_free(ScaleFilter *f) {
+    free(f->start);
+    free(f->count);
+    free(f->weights);
+}
+
+static int filter_init(ScaleFilter *f, int src_len, int dst_len) {
+    f->max_count = src_len / dst_len + 2;
+    f->start = (int *)malloc(dst_len * sizeof(int));
+    f->count = (int *)malloc(dst_len * sizeof(int));
+    f->weights = (Uint16 *)calloc(dst_len * f->max_count, sizeof(Uint16));
+    if (!f->start || !f->count || !f->weights) {
+        filter_free(f);
+        return -1;
+    }
+
+    // Positions are in units of 1/dst_len source pixels: destination pixel d
+    // spans [d * src_len, (d + 1) * src_len), source pixel i is dst_len wide.
+    // Weights are differences of the rounded running coverage, so they
+    // always add up to exactly SCALE_ONE.
+    for (int d = 0; d < dst_len; d++) {
+        long long lo = (long long)d * src_len;
+        long long hi = lo + src_len;
+        int first = (int)(lo / dst_len);
+        int last = (int)((hi - 1) / dst_len);
+        Uint16 *w = f->weights + d * f->max_count;
+        int covered = 0;
+
+        for (int i = first; i <= last; i++) {
+            long long end = (hi < (long long)(i + 1) * dst_len) ? hi : (long long)(i + 1) * dst_len;
+            int total = (int)(((end - lo) * SCALE_ONE + src_len / 2) / src_len);
+            w[i - first] = (Uint16)(total - covered);
+            covered = total;
+        }
+
+        f->start[d] = first;
+        f->count[d] = last - first + 1;
+    }
+    return 0;
+}
+
+// ============== Vertical Pass ==============
+
+// acc[i] += src[i] * weight over a whole source row
+static void accumulate_row(Uint16 *acc, const Uint8 *src, int n, Uint16 weight) {
+    int i = 0;
+
+#if defined(SCALE_NEON)
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t px = vld1q_u8(src + i);
+        vst1q_u16(acc + i, vmlaq_n_u16(vld1q_u16(acc + i), vmovl_u8(vget_low_u8(px)), weight));
+        vst1q_u16(acc + i + 8, vmlaq_n_u16(vld1q_u16(acc + i + 8), vmovl_u8(vget_high_u8(px)), weight));
+    }
+#elif defined(SCALE_SSE2)
+    __m128i zero = _mm_setzero_si128();
+    __m128i w = _mm_set1_epi16(weight);
+    for (; i + 16 <= n; i += 16) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i *a = (__m128i *)(acc + i);
+        __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(px, zero), w);
+        __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(px, zero), w);
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), hi));
+    }
+#endif
+
+    for (; i < n; i++) {
+        acc[i] += src[i] * weight;
+    }
+}
+
+// ============== Horizontal Pass ==============
+
+// Filter the summed rows into one destination row:
+// dst = round(sum(acc * weight) / SCALE_ONE^2)
+
+#define SCALE_ROUND (1 << (2 * SCALE_BITS - 1))
+
+static void output_row_8(const Uint16 *acc, Uint8 *dst, const ScaleFilter *f, int dst_w) {
+    for (int x = 0; x < dst_w; x++) {
+        const Uint16 *p = acc + f->start[x];
+        const Uint16 *w = f->weights + x * f->max_count;
+        Uint32 s0 = SCALE_ROUND;
+
+        for (int i = 0; i < f->count[x]; i++) {
+            s0 += (Uint32)p[i] * w[i];
+        }
+        dst[x] = s0 >> (2 * SCALE_BITS);
+    }
+}
+
+static void output_row_24(const Uint16 *acc, Uint8 *dst, const ScaleFilter *f, int dst_w) {
+    for (int x = 0; x < dst_w; x++, dst += 3) {
+        const Uint16 *p = acc + f->start[x] * 3;
+        const Uint16 *w = f->weights + x * f->max_count;
+        Uint32 s0 = SCALE_ROUND, s1 = SCALE_ROUND, s2 = SCALE_ROUND;
+
+        for (int i = 0; i < f->count[x]; i++, p += 3) {
+            s0 += (Uint32)p[0] * w[i];
+            s1 += (Uint32)p[1] * w[i];
+            s2 += (Uint32)p[2] * w[i];
+        }
+        dst[0] = s0 >> (2 * SCALE_BITS);
+        dst[1] = s1 >> (2 * SCALE_BITS);
+        dst[2] = s2 >> (2 * SCALE_BITS);
+    }
+}
+
+static void output_row_32(const Uint16 *acc, Uint8 *dst, const ScaleFilter *f, int dst_w) {
+    for (int x = 0; x < dst_w; x++, dst += 4) {
+        const Uint16 *p = acc + f->start[x] * 4;
+        const Uint16 *w = f->weights + x * f->max_count;
+
+#if defined(SCALE_NEON)
+        uint32x4_t sum = vdupq_n_u32(0);
+        for (int i = 0; i < f->count[x]; i++, p += 4) {
+            sum = vmlal_n_u16(sum, vld1_u16(p), w[i]);
+        }
+        uint16x4_t px = vrshrn_n_u32(sum, 2 * SCALE_BITS);
+        uint8x8_t out = vmovn_u16(vcombine_u16(px, px));
+        vst1_lane_u32((uint32_t *)dst, vreinterpret_u32_u8(out), 0);
+#elif defined(SCALE_SSE2)
+        // 16x16 -> 32-bit products from the low and high halves
+        __m128i sum = _mm_set1_epi32(SCALE_ROUND);
+        for (int i = 0; i < f->count[x]; i++, p += 4) {
+            __m128i px = _mm_loadl_epi64((const __m128i *)p);
+            __m128i wv = _mm_set1_epi16(w[i]);
+            __m128i lo = _mm_mullo_epi16(px, wv);
+            __m128i hi = _mm_mulhi_epu16(px, wv);
+            sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(lo, hi));
+        }
+        sum = _mm_srli_epi32(sum, 2 * SCALE_BITS);
+        sum = _mm_packs_epi32(sum, sum);
+        int bytes = _mm_cvtsi128_si32(_mm_packus_epi16(sum, sum));
+        memcpy(dst, &bytes, 4);
+#else
+        Uint32 s0 = SCALE_ROUND, s1 = SCALE_ROUND, s2 = SCALE_ROUND, s3 = SCALE_ROUND;
+        for (int i = 0; i < f->count[x]; i++, p += 4) {
+            s0 += (Uint32)p[0] * w[i];
+            s1 += (Uint32)p[1] * w[i];
+            s2 += (Uint32)p[2] * w[i];
+            s3 += (Uint32)p[3] * w[i];
+        }
+        dst[0] = s0 >> (2 * SCALE_BITS);
+        dst[1] = s1 >> (2 * SCALE_BITS);
+        dst[2] = s2 >> (2 * SCALE_BITS);
+        dst[3] = s3 >> (2 * SCALE_BITS);
+#endif
+    }
+}
+
+// ============== RGB565 ==============
+
+// 4x4 Bayer matrix: thresholds 0-15 spread evenly over each 4x4 block
+static const Uint8 dither_matrix[4][4] = {
+    { 0,  8,  2, 10},
+    {12,  4, 14,  6},
+    { 3, 11,  1,  9},
+    {15,  7, 13,  5}
+};
+
+static int is_rgb565(const SDL_PixelFormat *format) {
+    return format->BytesPerPixel == 2 && format->Rmask == RGB565_RMASK &&
+           format->Gmask == RGB565_GMASK && format->Bmask == RGB565_BMASK;
+}
+
+// Adding a threshold below one step (0-7 for 5 bits, 0-3 for 6) before
+// truncating rounds each pixel up or down so areas keep their average
+void dither_row_rgb565(const Uint8 *rgb, Uint16 *dst, int n, int x, int y) {
+    const Uint8 *m = dither_matrix[y & 3];
+    int i = 0;
+
+#if defined(SCALE_NEON)
+    // Thresholds of 8 pixels from x: the row of the matrix twice, so they
+    // stay in phase as i steps by 8
+    Uint8 t[8];
+    for (int k = 0; k < 8; k++) {
+        t[k] = m[(x + k) & 3];
+    }
+    uint8x8_t t5 = vshr_n_u8(vld1_u8(t), 1);
+    uint8x8_t t6 = vshr_n_u8(vld1_u8(t), 2);
+    for (; i + 8 <= n; i += 8) {
+        uint8x8x3_t px = vld3_u8(rgb + i * 3);
+        uint16x8_t out = vshll_n_u8(vqadd_u8(px.val[0], t5), 8);
+        out = vsriq_n_u16(out, vshll_n_u8(vqadd_u8(px.val[1], t6), 8), 5);
+        out = vsriq_n_u16(out, vshll_n_u8(vqadd_u8(px.val[2], t5), 8), 11);
+        vst1q_u16(dst + i, out);
+    }
+#endif
+
+    for (; i < n; i++) {
+        int t = m[(x + i) & 3];
+        int r = rgb[i * 3] + (t >> 1);
+        int g = rgb[i * 3 + 1] + (t >> 2);
+        int b = rgb[i * 3 + 2] + (t >> 1);
+        if (r > 255) r = 255;
+        if (g > 255) g = 255;
+        if (b > 255) b = 255;
+        dst[i] = (Uint16)(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+    }
+}
+
+// RGB565 back to 8-bit RGB. Plain shifts undo the dither's quantiser on
+// average, so filtering a dithered page again doesn't make it drift brighter.
+static void unpack_row_rgb565(const Uint16 *src, Uint8 *rgb, int n) {
+    for (int i = 0; i < n; i++, rgb += 3) {
+        Uint16 p = src[i];
+        rgb[0] = (p >> 8) & 0xF8;
+        rgb[1] = (p >> 3) & 0xFC;
+        rgb[2] = (p << 3) & 0xF8;
+    }
+}
+
+// Any surface row to 8-bit RGB
+static void unpack_row(SDL_Surface *src, const Uint8 *row, Uint8 *rgb) {
+    int bpp = src->format->BytesPerPixel;
+
+    for (int i = 0; i < src->w; i++, row += bpp, rgb += 3) {
+        Uint32 p;
+        if (bpp == 4) {
+            p = *(const Uint32 *)row;
+        } else if (bpp == 3) {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+            p = row[0] | (row[1] << 8) | (row[2] << 16);
+#else
+            p = (row[0] << 16) | (row[1] << 8) | row[2];
+#endif
+        } else if (bpp == 2) {
+            p = *(const Uint16 *)row;
+        } else {
+            p = *row;
+        }
+        SDL_GetRGB(p, src->format, &rgb[0], &rgb[1], &rgb[2]);
+    }
+}
+
+// Row y of src as 8-bit RGB: the decoders' 24-bit rows are that already,
+// others are unpacked into rgb (src->w * 3 bytes)
+static const Uint8 *rgb_row(SDL_Surface *src, int y, Uint8 *rgb) {
+    SDL_PixelFormat *format = src->format;
+    const Uint8 *row = (const Uint8 *)src->pixels + y * src->pitch;
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    if (format->BytesPerPixel == 3 && format->Rmask == 0x0000FF &&
+        format->Gmask == 0x00FF00 && format->Bmask == 0xFF0000) {
+#else
+    if (format->BytesPerPixel == 3 && format->Rmask == 0xFF0000 &&
+        format->Gmask == 0x00FF00 && format->Bmask == 0x0000FF) {
+#endif
+        return row;
+    }
+    unpack_row(src, row, rgb);
+    return rgb;
+}
+
+SDL_Surface *surface_to_rgb565(SDL_Surface *src) {
+    SDL_Surface *dst = SDL_CreateRGBSurface(SDL_SWSURFACE, src->w, src->h, 16,
+                                            RGB565_RMASK, RGB565_GMASK, RGB565_BMASK, 0);
+    Uint8 *rgb = (Uint8 *)malloc(src->w * 3);
+    if (!dst || !rgb) {
+        fprintf(stderr, "Failed to create RGB565 surface\n");
+        if (dst) SDL_FreeSurface(dst);
+        free(rgb);
+        return NULL;
+    }
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int y = 0; y < src->h; y++) {
+        const Uint8 *row = rgb_row(src, y, rgb);
+        dither_row_rgb565(row, (Uint16 *)((Uint8 *)dst->pixels + y * dst->pitch), src->w, 0, y);
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+
+    free(rgb);
+    return dst;
+}
+
+// ============== Grayscale ==============
+
+int is_gray_format(const SDL_PixelFormat *format) {
+    if (format->BitsPerPixel != 8 || !format->palette || format->palette->ncolors != 256) {
+        return 0;
+    }
+    for (int i = 0; i < 256; i++) {
+        SDL_Color *c = &format->palette->colors[i];
+        if (c->r != i || c->g != i || c->b != i) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Largest difference between the channels of n 8-bit RGB pixels
+static int row_chroma(const Uint8 *rgb, int n) {
+    int worst = 0;
+    int i = 0;
+
+#if defined(SCALE_NEON)
+    uint8x16_t acc = vdupq_n_u8(0);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x3_t px = vld3q_u8(rgb + i * 3);
+        acc = vmaxq_u8(acc, vmaxq_u8(vabdq_u8(px.val[0], px.val[1]),
+                                     vabdq_u8(px.val[1], px.val[2])));
+    }
+    uint8x8_t m = vmax_u8(vget_low_u8(acc), vget_high_u8(acc));
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    worst = vget_lane_u8(m, 0);
+#endif
+
+    for (; i < n; i++) {
+        int rg = rgb[i * 3] - rgb[i * 3 + 1];
+        int gb = rgb[i * 3 + 1] - rgb[i * 3 + 2];
+        if (rg < 0) rg = -rg;
+        if (gb < 0) gb = -gb;
+        if (rg > worst) worst = rg;
+        if (gb > worst) worst = gb;
+    }
+    return worst;
+}
+
+int surface_is_gray(SDL_Surface *src, int tolerance) {
+    if (is_gray_format(src->format)) {
+        return 1;
+    }
+
+    Uint8 *rgb = (Uint8 *)malloc(src->w * 3);
+    if (!rgb) {
+        return 0;
+    }
+
+    // Colour pages usually show it within a few rows
+    int gray = 1;
+    SDL_LockSurface(src);
+    for (int y = 0; gray && y < src->h; y++) {
+        gray = row_chroma(rgb_row(src, y, rgb), src->w) <= tolerance;
+    }
+    SDL_UnlockSurface(src);
+
+    free(rgb);
+    return gray;
+}
+
+void set_gray_palette(SDL_Surface *surface) {
+    SDL_Color colors[256];
+    for (int i = 0; i < 256; i++) {
+        colors[i].r = colors[i].g = colors[i].b = i;
+        colors[i].unused = 0;
+    }
+    SDL_SetColors(surface, colors, 0, 256);
+}
+
+void gray_row(const Uint8 *rgb, Uint8 *dst, int n) {
+    for (int i = 0; i < n; i++, rgb += 3) {
+        dst[i] = (rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29 + 128) >> 8;
+    }
+}
+
+SDL_Surface *surface_to_gray(SDL_Surface *src) {
+    SDL_Surface *dst = SDL_CreateRGBSurface(SDL_SWSURFACE, src->w, src->h, 8, 0, 0, 0, 0);
+    Uint8 *rgb = (Uint8 *)malloc(src->w * 3);
+    if (!dst || !rgb) {
+        fprintf(stderr, "Failed to create grayscale surface\n");
+        if (dst) SDL_FreeSurface(dst);
+        free(rgb);
+        return NULL;
+    }
+    set_gray_palette(dst);
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+    for (int y = 0; y < src->h; y++) {
+        gray_row(rgb_row(src, y, rgb), (Uint8 *)dst->pixels + y * dst->pitch, src->w);
+    }
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+
+    free(rgb);
+    return dst;
+}
+
+// ============== Scaling ==============
+
+int scale_area(SDL_Surface *src, SDL_Surface *dst) {
+    int bpp = src->format->BytesPerPixel;
+    int rgb565 = is_rgb565(src->format);
+    int gray = is_gray_format(src->format);
+    if ((bpp != 3 && bpp != 4 && !rgb565 && !gray) || dst->format->BytesPerPixel != bpp ||
+        dst->w > src->w || dst->h > src->h || dst->w <= 0 || dst->h <= 0) {
+        return -1;
+    }
+
+    ScaleFilter fx, fy;
+    if (filter_init(&fx, src->w, dst->w) != 0) {
+        return -1;
+    }
+    if (filter_init(&fy, src->h, dst->h) != 0) {
+        filter_free(&fx);
+        return -1;
+    }
+
+    // RGB565 rows are unpacked, filtered as 8-bit RGB and dithered back
+    int n = src->w * (rgb565 ? 3 : bpp);
+    Uint16 *acc = (Uint16 *)malloc(n * sizeof(Uint16));
+    Uint8 *unpacked = rgb565 ? (Uint8 *)malloc(n) : NULL;
+    Uint8 *out = rgb565 ? (Uint8 *)malloc(dst->w * 3) : NULL;
+    if (!acc || (rgb565 && (!unpacked || !out))) {
+        free(acc);
+        free(unpacked);
+        free(out);
+        filter_free(&fx);
+        filter_free(&fy);
+        return -1;
+    }
+
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+
+    // Sum the source rows of each destination row at full width (streams
+    // through the source once, vectorised on bytes), then filter that sum
+    // horizontally just once per destination row
+    for (int y = 0; y < dst->h; y++) {
+        const Uint16 *w = fy.weights + y * fy.max_count;
+
+        memset(acc, 0, n * sizeof(Uint16));
+        for (int i = 0; i < fy.count[y]; i++) {
+            if (w[i] == 0) continue;
+            const Uint8 *src_row = (const Uint8 *)src->pixels + (fy.start[y] + i) * src->pitch;
+            if (rgb565) {
+                unpack_row_rgb565((const Uint16 *)src_row, unpacked, src->w);
+                src_row = unpacked;
+            }
+            accumulate_row(acc, src_row, n, w[i]);
+        }
+
+        Uint8 *dst_row = (Uint8 *)dst->pixels + y * dst->pitch;
+        if (rgb565) {
+            output_row_24(acc, out, &fx, dst->w);
+            dither_row_rgb565(out, (Uint16 *)dst_row, dst->w, 0, y);
+        } else if (gray) {
+            output_row_8(acc, dst_row, &fx, dst->w);
+        } else if (bpp == 4) {
+            output_row_32(acc, dst_row, &fx, dst->w);
+        } else {
+            output_row_24(acc, dst_row, &fx, dst->w);
+        }
+    }
+
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+
+    free(acc);
+    free(unpacked);
+    free(out);
+    filter_free(&fx);
+    filter_free(&fy);
+    return 0;
+}
+
+void scale_nearest(SDL_Surface *src, SDL_Surface *dst) {
+    SDL_LockSurface(src);
+    SDL_LockSurface(dst);
+
+    Uint8 *src_pixels = (Uint8 *)src->pixels;
+    Uint8 *dst_pixels = (Uint8 *)dst->pixels;
+    int src_pitch = src->pitch;
+    int dst_pitch = dst->pitch;
+    int bpp = src->format->BytesPerPixel;
+
+    for (int y = 0; y < dst->h; y++) {
+        int src_y = (int)((long long)y * src->h / dst->h);
+
+        for (int x = 0; x < dst->w; x++) {
+            int src_x = (int)((long long)x * src->w / dst->w);
+
+            Uint8 *src_pixel = src_pixels + src_y * src_pitch + src_x * bpp;
+            Uint8 *dst_pixel = dst_pixels + y * dst_pitch + x * bpp;
+
+            memcpy(dst_pixel, src_pixel, bpp);
+        }
+    }
+
+    SDL_UnlockSurface(dst);
+    SDL_UnlockSurface(src);
+}
+
+SDL_Surface *scale_surface(SDL_Surface *src, int max_width, int max_height) {
+    if (!src) return NULL;
+
+    int src_w = src->w;
+    int src_h = src->h;
+
+    // Calculate scale factor to fit within bounds
+    float scale_x = (float)max_width / src_w;
+    float scale_y = (float)max_height / src_h;
+    float scale = (scale_x < scale_y) ? scale_x : scale_y;
+
+    // Don't upscale small images
+    if (scale > 1.0f) scale = 1.0f;
+
+    int dst_w = (int)(src_w * scale);
+    int dst_h = (int)(src_h * scale);
+    if (dst_w < 1) dst_w = 1;
+    if (dst_h < 1) dst_h = 1;
+
+    // If no scaling needed, just copy
+    if (dst_w == src_w && dst_h == src_h) {
+        SDL_Surface *copy = SDL_ConvertSurface(src, src->format, src->flags);
+        return copy;
+    }
+
+    // Create destination surface
+    SDL_Surface *dst = SDL_CreateRGBSurface(
+        SDL_SWSURFACE, dst_w, dst_h,
+        src->format->BitsPerPixel,
+        src->format->Rmask,
+        src->format->Gmask,
+        src->format->Bmask,
+        src->format->Amask
+    );
+
+    if (!dst) {
+        fprintf(stderr, "Failed to create scaled surface\n");
+        return NULL;
+    }
+    if (src->format->palette) {
+        SDL_SetColors(dst, src->format->palette->colors, 0, src->format->palette->ncolors);
+    }
+
+    // Colour paletted and other 16-bit surfaces can't be averaged channel-wise
+    if (scale_area(src, dst) != 0) {
+        scale_nearest(src, dst);
+    }
+
+    return dst;
+}
+
+// ============== Streaming ==============
+
+int row_scaler_init(RowScaler *sc, int src_w, int src_h, int dst_w, int dst_h) {
+    memset(sc, 0, sizeof(RowScaler));
+    if (dst_w < 1 || dst_h < 1 || dst_w > src_w || dst_h > src_h) {
+        return -1;
+    }
+
+    sc->src_w = src_w;
+    sc->src_h = src_h;
+    sc->dst_w = dst_w;
+    sc->dst_h = dst_h;
+    sc->sums = (Uint32 *)calloc(dst_w * 3, sizeof(Uint32));
+    sc->xmap = (int *)malloc(src_w * sizeof(int));
+    sc->xcount = (int *)calloc(dst_w, sizeof(int));
+    sc->out = (Uint8 *)malloc(dst_w * 3);
+    if (!sc->sums || !sc->xmap || !sc->xcount || !sc->out) {
+        row_scaler_free(sc);
+        return -1;
+    }
+
+    for (int x = 0; x < src_w; x++) {
+        sc->xmap[x] = (int)((long long)x * dst_w / src_w);
+        sc->xcount[sc->xmap[x]]++;
+    }
+    return 0;
+}
+
+int row_scaler_dst_row(const RowScaler *sc) {
+    return (int)((long long)sc->src_y * sc->dst_h / sc->src_h);
+}
+
+// Whether the next source row starts a new destination row
+static int row_scaler_row_done(const RowScaler *sc) {
+    return sc->src_y >= sc->src_h ||
+           (int)((long long)sc->src_y * sc->dst_h / sc->src_h) !=
+           (int)((long long)(sc->src_y - 1) * sc->dst_h / sc->src_h);
+}
+
+const Uint8 *row_scaler_push(RowScaler *sc, const Uint8 *src_row) {
+    const Uint8 *in = src_row;
+    for (int x = 0; x < sc->src_w; x++, in += 3) {
+        Uint32 *sum = sc->sums + sc->xmap[x] * 3;
+        sum[0] += in[0];
+        sum[1] += in[1];
+        sum[2] += in[2];
+    }
+    sc->rows++;
+    sc->src_y++;
+
+    if (!row_scaler_row_done(sc)) {
+        return NULL;
+    }
+
+    // Average the summed source rows
+    for (int x = 0; x < sc->dst_w; x++) {
+        Uint32 count = sc->xcount[x] * sc->rows;
+        Uint32 *sum = sc->sums + x * 3;
+        sc->out[x * 3 + 0] = (sum[0] + count / 2) / count;
+        sc->out[x * 3 + 1] = (sum[1] + count / 2) / count;
+        sc->out[x * 3 + 2] = (sum[2] + count / 2) / count;
+    }
+    memset(sc->sums, 0, sc->dst_w * 3 * sizeof(Uint32));
+    sc->rows = 0;
+    return sc->out;
+}
+
+void row_scaler_skip(RowScaler *sc) {
+    sc->src_y++;
+}
+
+void row_scaler_free(RowScaler *sc) {
+    free(sc->sums);
+    free(sc->xmap);
+    free(sc->xcount);
+    free(sc->out);
+    memset(sc, 0, sizeof(RowScaler));
+}
+
+const char *scale_kernel_name(void) {
+#if defined(SCALE_NEON)
+    return "NEON";
+#elif defined(SCALE_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
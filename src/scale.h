@@ -0,0 +1,85 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include <SDL.h>
+
+// Scale surface to fit within max dimensions while maintaining aspect ratio
+// (never upscales). Returns a new surface in src's format, NULL on failure.
+SDL_Surface *scale_surface(SDL_Surface *src, int max_width, int max_height);
+
+// Area-average src into dst (same format, no larger than src). Fixed-point
+// and separable, with SIMD kernels where available.
+// Returns 0 on success, -1 if the format isn't 24-, 32-bit, RGB565 or
+// 8-bit grayscale.
+int scale_area(SDL_Surface *src, SDL_Surface *dst);
+
+// Nearest neighbour src into dst (same format), works for any depth
+void scale_nearest(SDL_Surface *src, SDL_Surface *dst);
+
+// Streaming box filter for decoders that produce 24-bit rows one at a
+// time: each source pixel is summed into the destination pixel it falls
+// in, so only one row of sums is held however tall the image is
+typedef struct {
+    int src_w, src_h;
+    int dst_w, dst_h;
+    int src_y;              // Next source row
+    int rows;               // Source rows summed into the current destination row
+    Uint32 *sums;           // Per destination pixel channel sums
+    int *xmap;              // Destination column of each source column
+    int *xcount;            // Source columns summed into each destination column
+    Uint8 *out;             // Last finished destination row
+} RowScaler;
+
+// Set up a scaler from src_w x src_h to dst_w x dst_h (no larger than src)
+// Returns 0 on success, -1 on failure
+int row_scaler_init(RowScaler *sc, int src_w, int src_h, int dst_w, int dst_h);
+
+// Destination row the next source row falls in
+int row_scaler_dst_row(const RowScaler *sc);
+
+// Add the next source row. Returns the finished destination row (valid
+// until the next call) once its last source row is in, NULL before that.
+const Uint8 *row_scaler_push(RowScaler *sc, const Uint8 *src_row);
+
+// Pass over the next source row without summing it (its destination row
+// isn't wanted)
+void row_scaler_skip(RowScaler *sc);
+
+void row_scaler_free(RowScaler *sc);
+
+// 16-bit pages, for a 16-bit screen
+#define RGB565_RMASK 0xF800
+#define RGB565_GMASK 0x07E0
+#define RGB565_BMASK 0x001F
+
+// Ordered-dither n pixels of 8-bit RGB into RGB565. x, y is where the row
+// starts in the page, so the pattern lines up across rows and tiles.
+void dither_row_rgb565(const Uint8 *rgb, Uint16 *dst, int n, int x, int y);
+
+// Convert a surface to a new RGB565 surface, ordered-dithered
+// Returns NULL on failure
+SDL_Surface *surface_to_rgb565(SDL_Surface *src);
+
+// Black and white pages are kept as 8-bit surfaces with a gray ramp palette
+// (index i is gray level i), a quarter of the memory of 32-bit ones
+
+// Check for an 8-bit surface format with the gray ramp palette
+int is_gray_format(const SDL_PixelFormat *format);
+
+// Check whether no pixel's channels differ by more than tolerance
+int surface_is_gray(SDL_Surface *src, int tolerance);
+
+// Give an 8-bit surface the gray ramp palette
+void set_gray_palette(SDL_Surface *surface);
+
+// Luma of n pixels of 8-bit RGB
+void gray_row(const Uint8 *rgb, Uint8 *dst, int n);
+
+// Convert a surface to a new 8-bit grayscale surface
+// Returns NULL on failure
+SDL_Surface *surface_to_gray(SDL_Surface *src);
+
+// Name of the kernels compiled in ("NEON", "SSE2" or "scalar")
+const char *scale_kernel_name(void);
+
+#endif
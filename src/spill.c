@@ -0,0 +1,101 @@
+#include "spill.h"
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+int spill_open(SpillStore *spill, int page_count, long long budget) {
+    memset(spill, 0, sizeof(SpillStore));
+
+    spill->offsets = (long long *)malloc(page_count * sizeof(long long));
+    spill->sizes = (size_t *)calloc(page_count, sizeof(size_t));
+    if (!spill->offsets || !spill->sizes) {
+        spill_close(spill);
+        return -1;
+    }
+    for (int i = 0; i < page_count; i++) {
+        spill->offsets[i] = -1;
+    }
+    spill->page_count = page_count;
+    spill->budget = budget;
+
+    mkdir(SPILL_DIR, 0755);
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/spill-%d.tmp", SPILL_DIR, (int)getpid());
+
+    spill->file = fopen(path, "w+b");
+    if (!spill->file) {
+        fprintf(stderr, "Failed to create spill file: %s\n", path);
+        spill_close(spill);
+        return -1;
+    }
+
+    // Unlink right away; the space is reclaimed when the file is closed,
+    // even if the app is killed
+    remove(path);
+    return 0;
+}
+
+void spill_close(SpillStore *spill) {
+    if (spill->file) {
+        fclose(spill->file);
+    }
+    free(spill->offsets);
+    free(spill->sizes);
+    memset(spill, 0, sizeof(SpillStore));
+}
+
+int spill_has(SpillStore *spill, int page_index) {
+    return spill->file && page_index >= 0 && page_index < spill->page_count &&
+           spill->offsets[page_index] >= 0;
+}
+
+int spill_wants(SpillStore *spill, int page_index, size_t size) {
+    return spill->file && page_index >= 0 && page_index < spill->page_count &&
+           spill->offsets[page_index] < 0 &&
+           spill->used + (long long)size <= spill->budget;
+}
+
+int spill_put(SpillStore *spill, int page_index, const unsigned char *data, size_t size) {
+    if (spill_has(spill, page_index)) {
+        return 0;
+    }
+    if (!spill_wants(spill, page_index, size)) {
+        return -1;
+    }
+
+    // Append only: pages are never rewritten while the comic is open
+    if (fseeko(spill->file, spill->used, SEEK_SET) != 0 ||
+        fwrite(data, 1, size, spill->file) != size) {
+        fprintf(stderr, "Failed to spill page %d\n", page_index);
+        return -1;
+    }
+
+    spill->offsets[page_index] = spill->used;
+    spill->sizes[page_index] = size;
+    spill->used += size;
+    return 0;
+}
+
+unsigned char *spill_get(SpillStore *spill, int page_index, size_t *out_size) {
+    if (!spill_has(spill, page_index)) {
+        return NULL;
+    }
+
+    size_t size = spill->sizes[page_index];
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (!data) {
+        return NULL;
+    }
+
+    if (fseeko(spill->file, spill->offsets[page_index], SEEK_SET) != 0 ||
+        fread(data, 1, size, spill->file) != size) {
+        fprintf(stderr, "Failed to read spilled page %d\n", page_index);
+        free(data);
+        return NULL;
+    }
+
+    *out_size = size;
+    return data;
+}
@@ -0,0 +1,41 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// Decoded page bytes of solid CBRs are spilled to a scratch file so that
+// paging backwards doesn't have to re-run the RAR decoder from the start.
+#define SPILL_DIR "/media/internal/.comic-reader"
+#define SPILL_MAX_BYTES (128LL * 1024 * 1024)  // Flash budget per open comic
+
+typedef struct {
+    FILE *file;             // Unlinked scratch file, NULL if unavailable
+    long long *offsets;     // Per page offset in file, -1 if not stored
+    size_t *sizes;          // Per page size in bytes
+    int page_count;
+    long long used;         // Bytes written so far
+    long long budget;       // Max bytes to write
+} SpillStore;
+
+// Create an empty spill store for page_count pages
+// Returns 0 on success, -1 on failure (store stays unusable but safe to call)
+int spill_open(SpillStore *spill, int page_count, long long budget);
+
+// Delete the scratch file and free bookkeeping
+void spill_close(SpillStore *spill);
+
+// Check whether a page is stored
+int spill_has(SpillStore *spill, int page_index);
+
+// Check whether a page of the given size would be stored by spill_put
+int spill_wants(SpillStore *spill, int page_index, size_t size);
+
+// Store a page's bytes; silently skipped once the budget is used up
+// Returns 0 if stored, -1 otherwise
+int spill_put(SpillStore *spill, int page_index, const unsigned char *data, size_t size);
+
+// Read a stored page back (caller must free), NULL if not stored
+unsigned char *spill_get(SpillStore *spill, int page_index, size_t *out_size);
+
+#endif
@@ -0,0 +1,299 @@
+#include "tiles.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+int tiles_init(TiledPage *tiled, int page_index, int width, int height) {
+    memset(tiled, 0, sizeof(TiledPage));
+    tiled->page_index = -1;
+
+    int cols = (width + TILE_SIZE - 1) >> TILE_SHIFT;
+    int rows = (height + TILE_SIZE - 1) >> TILE_SHIFT;
+    tiled->tiles = (Tile *)calloc(cols * rows, sizeof(Tile));
+    if (!tiled->tiles) {
+        return -1;
+    }
+
+    tiled->page_index = page_index;
+    tiled->width = width;
+    tiled->height = height;
+    tiled->cols = cols;
+    tiled->rows = rows;
+    return 0;
+}
+
+void tiles_free(TiledPage *tiled) {
+    for (int i = 0; tiled->tiles && i < tiled->cols * tiled->rows; i++) {
+        if (tiled->tiles[i].surface) {
+            SDL_FreeSurface(tiled->tiles[i].surface);
+        }
+    }
+    free(tiled->tiles);
+    memset(tiled, 0, sizeof(TiledPage));
+    tiled->page_index = -1;
+}
+
+Tile *tiles_at(TiledPage *tiled, int col, int row) {
+    if (!tiled->tiles || col < 0 || row < 0 || col >= tiled->cols || row >= tiled->rows) {
+        return NULL;
+    }
+    return &tiled->tiles[row * tiled->cols + col];
+}
+
+// ============== Decoding ==============
+
+void tile_decoder_init(TileDecoder *dec) {
+    memset(dec, 0, sizeof(TileDecoder));
+    dec->page_index = -1;
+}
+
+int tile_decoder_continues(TileDecoder *dec, TileJob *job) {
+    return dec->page_index == job->page_index && dec->width == job->width &&
+           dec->height == job->height &&
+           row_scaler_dst_row(&dec->sc) <= (job->row0 << TILE_SHIFT);
+}
+
+int tile_decoder_open(TileDecoder *dec, TileJob *job, SDL_RWops *rw) {
+    tile_decoder_close(dec);
+    dec->rw = rw;
+
+    int width, height;
+    if (jpeg_sniff(rw)) {
+        if (jpeg_rows_open(&dec->jpeg, rw, job->width, job->height) != 0) {
+            tile_decoder_close(dec);
+            return -1;
+        }
+        dec->is_jpeg = 1;
+        width = dec->jpeg.width;
+        height = dec->jpeg.height;
+    } else if (png_sniff(rw) && png_rows_open(&dec->png, rw) == 0) {
+        width = dec->png.width;
+        height = dec->png.height;
+    } else {
+        tile_decoder_close(dec);
+        return -1;
+    }
+    dec->page_index = job->page_index;
+
+    dec->row = (Uint8 *)malloc(width * 3);
+    if (!dec->row || row_scaler_init(&dec->sc, width, height, job->width, job->height) != 0) {
+        tile_decoder_close(dec);
+        return -1;
+    }
+    dec->width = job->width;
+    dec->height = job->height;
+    return 0;
+}
+
+void tile_decoder_close(TileDecoder *dec) {
+    if (dec->page_index >= 0) {
+        if (dec->is_jpeg) {
+            jpeg_rows_close(&dec->jpeg);
+        } else {
+            png_rows_close(&dec->png);
+        }
+    }
+    row_scaler_free(&dec->sc);
+    free(dec->row);
+    if (dec->rw) {
+        SDL_RWclose(dec->rw);
+    }
+    tile_decoder_init(dec);
+}
+
+// Copy a finished level row into the job's tiles it crosses
+static void put_row(TileJob *job, const Uint8 *row, int y) {
+    int cols = job->col1 - job->col0 + 1;
+    int tile_y = y & (TILE_SIZE - 1);
+    SDL_Surface **tiles = job->tiles + ((y >> TILE_SHIFT) - job->row0) * cols;
+
+    for (int i = 0; i < cols; i++) {
+        SDL_Surface *tile = tiles[i];
+        int x = (job->col0 + i) << TILE_SHIFT;
+        Uint8 *out = (Uint8 *)tile->pixels + tile_y * tile->pitch;
+        if (job->gray) {
+            gray_row(row + x * 3, out, tile->w);
+        } else if (job->rgb565) {
+            dither_row_rgb565(row + x * 3, (Uint16 *)out, tile->w, x, y);
+        } else {
+            memcpy(out, row + x * 3, tile->w * 3);
+        }
+    }
+}
+
+int tiles_decode(TileDecoder *dec, TileJob *job) {
+    int cols = job->col1 - job->col0 + 1;
+    int rows = job->row1 - job->row0 + 1;
+
+    job->tiles = (SDL_Surface **)calloc(cols * rows, sizeof(SDL_Surface *));
+    int ok = dec->width > 0 && job->tiles;
+
+    for (int i = 0; ok && i < cols * rows; i++) {
+        int x = (job->col0 + i % cols) << TILE_SHIFT;
+        int y = (job->row0 + i / cols) << TILE_SHIFT;
+        int w = (job->width - x < TILE_SIZE) ? job->width - x : TILE_SIZE;
+        int h = (job->height - y < TILE_SIZE) ? job->height - y : TILE_SIZE;
+        if (job->gray) {
+            job->tiles[i] = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 8, 0, 0, 0, 0);
+            if (job->tiles[i]) set_gray_palette(job->tiles[i]);
+        } else if (job->rgb565) {
+            job->tiles[i] = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 16, RGB565_RMASK,
+                                                 RGB565_GMASK, RGB565_BMASK, 0);
+        } else {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+            job->tiles[i] = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 24, 0x0000FF, 0x00FF00, 0xFF0000, 0);
+#else
+            job->tiles[i] = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, 24, 0xFF0000, 0x00FF00, 0x0000FF, 0);
+#endif
+        }
+        ok = job->tiles[i] != NULL;
+    }
+
+    // Rows between where dec is and the range are decoded and dropped
+    // without being scaled, and decoding stops past the range
+    int first_y = job->row0 << TILE_SHIFT;
+    int last_y = (job->row1 + 1) << TILE_SHIFT;
+    if (last_y > job->height) last_y = job->height;
+
+    while (ok) {
+        int y = row_scaler_dst_row(&dec->sc);
+        if (y >= last_y) {
+            break;
+        }
+
+        ok = (dec->is_jpeg ? jpeg_rows_read(&dec->jpeg, dec->row)
+                           : png_rows_read(&dec->png, dec->row)) == 0;
+        if (!ok) {
+            break;
+        }
+
+        const Uint8 *out;
+        if (y < first_y) {
+            row_scaler_skip(&dec->sc);
+        } else if ((out = row_scaler_push(&dec->sc, dec->row))) {
+            put_row(job, out, y);
+        }
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Failed to decode tiles of page %d\n", job->page_index);
+        tile_decoder_close(dec);
+        tiles_free_job(job);
+        return -1;
+    }
+    return 0;
+}
+
+void tiles_free_job(TileJob *job) {
+    int count = (job->col1 - job->col0 + 1) * (job->row1 - job->row0 + 1);
+
+    for (int i = 0; job->tiles && i < count; i++) {
+        if (job->tiles[i]) {
+            SDL_FreeSurface(job->tiles[i]);
+        }
+    }
+    free(job->tiles);
+    job->tiles = NULL;
+}
+
+// ============== Drawing ==============
+
+// Nearest neighbour from the tiles, or fallback where they're missing
+static void draw_sampled(TiledPage *tiled, SDL_Surface *fallback, View *view,
+                         int src_x, int src_y, int src_w, int src_h,
+                         int dst_x, int dst_y, int dst_w, int dst_h) {
+    if (dst_w <= 0 || dst_h <= 0) {
+        return;
+    }
+
+    // Level column of each destination column (and row of each row), and
+    // where that is in its tile and in fallback
+    int *maps = (int *)malloc((dst_w + dst_h) * 3 * sizeof(int));
+    if (!maps) {
+        return;
+    }
+    int *level_x = maps;
+    int *tile_x = level_x + dst_w;
+    int *fallback_x = tile_x + dst_w;
+    int *level_y = fallback_x + dst_w;
+    int *tile_y = level_y + dst_h;
+    int *fallback_y = tile_y + dst_h;
+
+    for (int dx = 0; dx < dst_w; dx++) {
+        int x = src_x + (int)((long long)dx * src_w / dst_w);
+        level_x[dx] = x;
+        tile_x[dx] = x & (TILE_SIZE - 1);
+        fallback_x[dx] = (int)((long long)x * fallback->w / tiled->width);
+    }
+    for (int dy = 0; dy < dst_h; dy++) {
+        int y = src_y + (int)((long long)dy * src_h / dst_h);
+        level_y[dy] = y;
+        tile_y[dy] = y & (TILE_SIZE - 1);
+        fallback_y[dy] = (int)((long long)y * fallback->h / tiled->height);
+    }
+
+    // The destination columns and rows falling in one tile are drawn in one
+    // go, from the tile or from fallback
+    for (int dy = 0; dy < dst_h; ) {
+        int row = level_y[dy] >> TILE_SHIFT;
+        int dy1 = dy + 1;
+        while (dy1 < dst_h && (level_y[dy1] >> TILE_SHIFT) == row) dy1++;
+
+        for (int dx = 0; dx < dst_w; ) {
+            int col = level_x[dx] >> TILE_SHIFT;
+            int dx1 = dx + 1;
+            while (dx1 < dst_w && (level_x[dx1] >> TILE_SHIFT) == col) dx1++;
+
+            SDL_Surface *tile = tiled->tiles[row * tiled->cols + col].surface;
+            if (tile) {
+                view_blit_mapped(view, tile, tile_x + dx, tile_y + dy,
+                                 dst_x + dx, dst_y + dy, dx1 - dx, dy1 - dy);
+            } else {
+                view_blit_mapped(view, fallback, fallback_x + dx, fallback_y + dy,
+                                 dst_x + dx, dst_y + dy, dx1 - dx, dy1 - dy);
+            }
+            dx = dx1;
+        }
+        dy = dy1;
+    }
+
+    free(maps);
+}
+
+void tiles_draw(TiledPage *tiled, SDL_Surface *fallback, View *view,
+                int src_x, int src_y, int src_w, int src_h,
+                int dst_x, int dst_y, int dst_w, int dst_h) {
+    if (src_w != dst_w || src_h != dst_h) {
+        draw_sampled(tiled, fallback, view, src_x, src_y, src_w, src_h,
+                     dst_x, dst_y, dst_w, dst_h);
+        return;
+    }
+
+    // 1:1: copy the visible part of each tile
+    for (int row = src_y >> TILE_SHIFT; row <= (src_y + src_h - 1) >> TILE_SHIFT; row++) {
+        for (int col = src_x >> TILE_SHIFT; col <= (src_x + src_w - 1) >> TILE_SHIFT; col++) {
+            Tile *tile = tiles_at(tiled, col, row);
+            if (!tile) continue;
+
+            int x0 = col << TILE_SHIFT;
+            int y0 = row << TILE_SHIFT;
+            int x1 = x0 + TILE_SIZE;
+            int y1 = y0 + TILE_SIZE;
+            if (x0 < src_x) x0 = src_x;
+            if (y0 < src_y) y0 = src_y;
+            if (x1 > src_x + src_w) x1 = src_x + src_w;
+            if (y1 > src_y + src_h) y1 = src_y + src_h;
+
+            int out_x = dst_x + x0 - src_x;
+            int out_y = dst_y + y0 - src_y;
+            if (tile->surface) {
+                SDL_Rect src_rect = {x0 - (col << TILE_SHIFT), y0 - (row << TILE_SHIFT),
+                                     x1 - x0, y1 - y0};
+                view_blit(view, tile->surface, &src_rect, out_x, out_y);
+            } else {
+                draw_sampled(tiled, fallback, view, x0, y0, x1 - x0, y1 - y0,
+                             out_x, out_y, x1 - x0, y1 - y0);
+            }
+        }
+    }
+}
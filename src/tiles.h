@@ -0,0 +1,102 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <SDL.h>
+#include "jpeg_decode.h"
+#include "png_decode.h"
+#include "rotate.h"
+#include "scale.h"
+
+// The high resolution level of a zoomed page is split into tiles that are
+// decoded as they scroll into view, so deep zoom never holds the whole
+// page at that resolution
+#define TILE_SIZE 256
+#define TILE_SHIFT 8        // log2(TILE_SIZE)
+#define TILE_RING 1         // Tiles kept around the visible ones
+
+typedef struct {
+    SDL_Surface *surface;   // NULL until decoded
+    int pending;            // Serial of the job decoding it, 0 if none
+} Tile;
+
+// Tiled level of one page
+typedef struct {
+    int page_index;         // -1 if none
+    int width;              // Size of the whole level
+    int height;
+    int cols;
+    int rows;
+    int gray;               // 1 if tiles are 8-bit grayscale like the page
+    Tile *tiles;            // cols * rows, row major
+} TiledPage;
+
+// Tiles for a worker to decode: a range of tile rows and columns
+typedef struct {
+    int serial;             // Tells jobs apart, never 0
+    int page_index;
+    int width;              // Level size, as in TiledPage
+    int height;
+    int col0, row0;         // First tile
+    int col1, row1;         // Last tile (inclusive)
+    int rgb565;             // 1 to dither tiles to RGB565 instead of 24-bit
+    int gray;               // 1 for 8-bit grayscale tiles (takes precedence)
+    SDL_Surface **tiles;    // Decoded tiles over the range, NULL if decoding failed
+} TileJob;
+
+// A page open for decoding tiles. Decoders only go top-down, so it stays
+// open between jobs: a job below the last one carries on from there, only
+// one above it starts the page over.
+typedef struct {
+    int page_index;         // -1 if none open
+    int width;              // Level size it decodes for
+    int height;
+    SDL_RWops *rw;
+    int is_jpeg;
+    JpegRows jpeg;
+    PngRows png;
+    RowScaler sc;
+    Uint8 *row;             // Source row being decoded
+} TileDecoder;
+
+// Set up an empty tiled level of width x height for a page
+// Returns 0 on success, -1 on failure
+int tiles_init(TiledPage *tiled, int page_index, int width, int height);
+
+// Free all tiles (tiled stays usable as an empty level)
+void tiles_free(TiledPage *tiled);
+
+// Get a tile, NULL if outside the level
+Tile *tiles_at(TiledPage *tiled, int col, int row);
+
+// Set up a decoder with no page open
+void tile_decoder_init(TileDecoder *dec);
+
+// Check whether dec is open on the job's page and level and hasn't gone
+// past the job's first row yet
+int tile_decoder_continues(TileDecoder *dec, TileJob *job);
+
+// Open the page image in rw for the job's level; dec owns rw from then on,
+// and closes it on failure. JPEG and PNG pages only.
+// Returns 0 on success, -1 on failure
+int tile_decoder_open(TileDecoder *dec, TileJob *job, SDL_RWops *rw);
+
+// Close the page, if any
+void tile_decoder_close(TileDecoder *dec);
+
+// Decode the job's tiles with dec, which should be open for it. Rows are
+// decoded top-down from where dec is and decoding stops after the job's
+// last row, leaving dec there for the next job. dec is closed on failure.
+// Returns 0 on success, -1 on failure
+int tiles_decode(TileDecoder *dec, TileJob *job);
+
+// Free a job and any tiles it still holds
+void tiles_free_job(TileJob *job);
+
+// Draw the part of the level at (src_x, src_y, src_w, src_h) in level pixels
+// into view at (dst_x, dst_y, dst_w, dst_h). Tiles not decoded yet are
+// sampled from fallback, a smaller copy of the whole page.
+void tiles_draw(TiledPage *tiled, SDL_Surface *fallback, View *view,
+                int src_x, int src_y, int src_w, int src_h,
+                int dst_x, int dst_y, int dst_w, int dst_h);
+
+#endif
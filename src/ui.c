@@ -1,5 +1,6 @@
 #include "ui.h"
 #include "webdav.h"
+#include "rotate.h"
 #include <PDL.h>
 #include <PDL_Sensors.h>
 #include <stdio.h>
@@ -30,6 +31,27 @@ static const char *FONT_PATHS[] = {
 // Portrait mode render surface (768x1024)
 static SDL_Surface *portrait_surface = NULL;
 
+// Wakes the main loop to poll the orientation sensor
+static SDL_TimerID sensor_timer = NULL;
+static volatile int sensor_event_queued = 0;
+
+// Runs on SDL's timer thread: push a sensor event unless one is still
+// queued, so a busy main loop doesn't fill the event queue
+static Uint32 sensor_timer_tick(Uint32 interval, void *param) {
+    (void)param;
+    if (!sensor_event_queued) {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = SDL_USEREVENT;
+        event.user.code = UI_EVENT_SENSOR;
+        sensor_event_queued = 1;
+        if (SDL_PushEvent(&event) != 0) {
+            sensor_event_queued = 0;
+        }
+    }
+    return interval;
+}
+
 static TTF_Font *load_font(int size) {
     for (int i = 0; FONT_PATHS[i]; i++) {
         TTF_Font *font = TTF_OpenFont(FONT_PATHS[i], size);
@@ -57,7 +79,7 @@ static SDL_Surface *get_render_surface(UIState *ui) {
     // Create portrait surface if needed
     if (!portrait_surface) {
         portrait_surface = SDL_CreateRGBSurface(SDL_SWSURFACE,
-            SCREEN_HEIGHT, SCREEN_WIDTH, 32,  // 768x1024
+            SCREEN_HEIGHT, SCREEN_WIDTH, ui->screen->format->BitsPerPixel,  // 768x1024
             ui->screen->format->Rmask, ui->screen->format->Gmask,
             ui->screen->format->Bmask, ui->screen->format->Amask);
     }
@@ -67,7 +89,13 @@ static SDL_Surface *get_render_surface(UIState *ui) {
 int ui_init(UIState *ui) {
     memset(ui, 0, sizeof(UIState));
 
-    ui->screen = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE);
+    // Screen depth comes from the config; the rest of it is loaded again
+    // by ui_load_cloud_config
+    config_init(&ui->cloud_config);
+    config_load(&ui->cloud_config, CONFIG_FILE_PATH);
+
+    ui->screen = SDL_SetVideoMode(SCREEN_WIDTH, SCREEN_HEIGHT, ui->cloud_config.screen_depth,
+                                  SDL_SWSURFACE);
     if (!ui->screen) {
         fprintf(stderr, "SDL_SetVideoMode failed: %s\n", SDL_GetError());
         return -1;
@@ -100,11 +128,14 @@ int ui_init(UIState *ui) {
     ui->browse_mode = 0;  // Start in local mode
     strcpy(ui->cloud_path, "/");
     ui->cloud_configured = 0;
-    config_init(&ui->cloud_config);
 
     // Enable orientation sensor
     if (PDL_SensorExists(PDL_SENSOR_ORIENTATION)) {
         PDL_EnableSensor(PDL_SENSOR_ORIENTATION, PDL_TRUE);
+        sensor_timer = SDL_AddTimer(ORIENTATION_POLL_MS, sensor_timer_tick, NULL);
+        if (!sensor_timer) {
+            fprintf(stderr, "SDL_AddTimer failed: %s\n", SDL_GetError());
+        }
         printf("Orientation sensor enabled\n");
     }
 
@@ -112,12 +143,14 @@ int ui_init(UIState *ui) {
     mkdir(CLOUD_CACHE_DIR, 0755);
     mkdir("/media/internal/.comic-reader", 0755);
 
+    ui_invalidate(ui, NULL);
     return 0;
 }
 
 // Poll orientation sensor and update state with debounce
 void ui_poll_orientation(UIState *ui) {
     PDL_SensorEvent sensor_event;
+    sensor_event_queued = 0;
 
     // Check for orientation sensor events
     while (PDL_PollSensor(PDL_SENSOR_ORIENTATION, &sensor_event) == PDL_NOERROR &&
@@ -159,6 +192,7 @@ void ui_poll_orientation(UIState *ui) {
         Uint32 now = SDL_GetTicks();
         if (now - ui->orientation_change_time >= ORIENTATION_DEBOUNCE_MS) {
             ui->orientation = ui->pending_orientation;
+            ui_invalidate(ui, NULL);
             printf("Orientation: %s\n",
                    ui->orientation == 0 ? "Landscape" :
                    ui->orientation == 1 ? "Portrait Inverted" : "Portrait");
@@ -168,6 +202,10 @@ void ui_poll_orientation(UIState *ui) {
 
 void ui_cleanup(UIState *ui) {
     // Disable orientation sensor
+    if (sensor_timer) {
+        SDL_RemoveTimer(sensor_timer);
+        sensor_timer = NULL;
+    }
     if (PDL_SensorExists(PDL_SENSOR_ORIENTATION)) {
         PDL_EnableSensor(PDL_SENSOR_ORIENTATION, PDL_FALSE);
     }
@@ -187,10 +225,95 @@ void ui_cleanup(UIState *ui) {
 void ui_set_screen(UIState *ui, ScreenState state) {
     ui->state = state;
     ui->scroll_offset = 0;
+    ui_invalidate(ui, NULL);
 }
 
 void ui_set_message(UIState *ui, const char *message) {
     strncpy(ui->message, message, sizeof(ui->message) - 1);
+    ui_invalidate(ui, NULL);
+}
+
+// Grow a to also cover b
+static void union_rect(SDL_Rect *a, const SDL_Rect *b) {
+    int x0 = (a->x < b->x) ? a->x : b->x;
+    int y0 = (a->y < b->y) ? a->y : b->y;
+    int x1 = (a->x + a->w > b->x + b->w) ? a->x + a->w : b->x + b->w;
+    int y1 = (a->y + a->h > b->y + b->h) ? a->y + a->h : b->y + b->h;
+    a->x = x0;
+    a->y = y0;
+    a->w = x1 - x0;
+    a->h = y1 - y0;
+}
+
+void ui_invalidate(UIState *ui, const SDL_Rect *area) {
+    int vw, vh;
+    get_virtual_size(ui, &vw, &vh);
+
+    if (!area) {
+        SDL_Rect full = {0, 0, vw, vh};
+        ui->damage[0] = full;
+        ui->damage_count = 1;
+        return;
+    }
+
+    // Clip to the virtual screen
+    int x0 = area->x < 0 ? 0 : area->x;
+    int y0 = area->y < 0 ? 0 : area->y;
+    int x1 = area->x + area->w > vw ? vw : area->x + area->w;
+    int y1 = area->y + area->h > vh ? vh : area->y + area->h;
+    if (x1 <= x0 || y1 <= y0) return;
+    SDL_Rect rect = {x0, y0, x1 - x0, y1 - y0};
+
+    // Already covered
+    for (int i = 0; i < ui->damage_count; i++) {
+        SDL_Rect *d = &ui->damage[i];
+        if (x0 >= d->x && y0 >= d->y && x1 <= d->x + d->w && y1 <= d->y + d->h) return;
+    }
+
+    if (ui->damage_count == UI_MAX_DAMAGE) {
+        for (int i = 1; i < ui->damage_count; i++) {
+            union_rect(&ui->damage[0], &ui->damage[i]);
+        }
+        union_rect(&ui->damage[0], &rect);
+        ui->damage_count = 1;
+    } else {
+        ui->damage[ui->damage_count++] = rect;
+    }
+}
+
+// The reader's page area, everything above the status bar
+static void invalidate_page_area(UIState *ui) {
+    int vw, vh;
+    get_virtual_size(ui, &vw, &vh);
+    SDL_Rect area = {0, 0, vw, vh - 40};
+    ui_invalidate(ui, &area);
+}
+
+// Count the time from the oldest input not on screen yet to now
+static void record_latency(UIState *ui) {
+    Uint32 ms = SDL_GetTicks() - ui->input_time;
+    LatencyStats *stats = &ui->latency[ui->input_kind];
+    stats->count++;
+    stats->total_ms += ms;
+    if (ms > stats->max_ms) stats->max_ms = ms;
+
+    if (ui->input_kind == LATENCY_PAGE_TURN) {
+        printf("Page %d on screen %u ms after input\n", ui->current_page + 1, ms);
+    }
+    ui->input_pending = 0;
+}
+
+static const char *LATENCY_NAMES[LATENCY_KINDS] = {"page turn", "zoom", "pan", "other"};
+
+// Print and reset the latency counts
+static void report_latency(UIState *ui) {
+    for (int i = 0; i < LATENCY_KINDS; i++) {
+        LatencyStats *stats = &ui->latency[i];
+        if (stats->count == 0) continue;
+        printf("Latency %s: %u inputs, avg %u ms, max %u ms\n", LATENCY_NAMES[i],
+               stats->count, stats->total_ms / stats->count, stats->max_ms);
+    }
+    memset(ui->latency, 0, sizeof(ui->latency));
 }
 
 static void draw_text(SDL_Surface *screen, TTF_Font *font, const char *text,
@@ -209,62 +332,6 @@ static void draw_rect(SDL_Surface *screen, int x, int y, int w, int h, SDL_Color
     SDL_FillRect(screen, &rect, SDL_MapRGB(screen->format, color.r, color.g, color.b));
 }
 
-// Blit portrait surface (768x1024) to screen (1024x768) with rotation
-// orientation: 1 = 90° CCW, 2 = 90° CW
-static void blit_portrait_to_screen(SDL_Surface *portrait, SDL_Surface *screen, int orientation) {
-    if (!portrait || !screen) return;
-
-    int src_w = portrait->w;   // 768
-    int src_h = portrait->h;   // 1024
-    int dst_w = screen->w;     // 1024
-    int dst_h = screen->h;     // 768
-    int bpp = portrait->format->BytesPerPixel;
-
-    SDL_LockSurface(portrait);
-    SDL_LockSurface(screen);
-
-    Uint8 *src = (Uint8 *)portrait->pixels;
-    Uint8 *dst = (Uint8 *)screen->pixels;
-
-    // Portrait (768x1024) rotated 90° fits perfectly in landscape (1024x768)
-    // After rotation: 1024 wide, 768 tall - exact fit!
-
-    if (orientation == 1) {
-        // 90° CCW: portrait(x,y) → screen(y, src_w-1-x)
-        // Reverse: screen(dx,dy) ← portrait(src_w-1-dy, dx)
-        for (int dy = 0; dy < dst_h; dy++) {
-            Uint8 *dst_row = dst + dy * screen->pitch;
-            for (int dx = 0; dx < dst_w; dx++) {
-                int sx = src_w - 1 - dy;
-                int sy = dx;
-                if (sx >= 0 && sx < src_w && sy >= 0 && sy < src_h) {
-                    Uint8 *src_pixel = src + sy * portrait->pitch + sx * bpp;
-                    Uint8 *dst_pixel = dst_row + dx * bpp;
-                    memcpy(dst_pixel, src_pixel, bpp);
-                }
-            }
-        }
-    } else if (orientation == 2) {
-        // 90° CW: portrait(x,y) → screen(src_h-1-y, x)
-        // Reverse: screen(dx,dy) ← portrait(dy, src_h-1-dx)
-        for (int dy = 0; dy < dst_h; dy++) {
-            Uint8 *dst_row = dst + dy * screen->pitch;
-            for (int dx = 0; dx < dst_w; dx++) {
-                int sx = dy;
-                int sy = src_h - 1 - dx;
-                if (sx >= 0 && sx < src_w && sy >= 0 && sy < src_h) {
-                    Uint8 *src_pixel = src + sy * portrait->pitch + sx * bpp;
-                    Uint8 *dst_pixel = dst_row + dx * bpp;
-                    memcpy(dst_pixel, src_pixel, bpp);
-                }
-            }
-        }
-    }
-
-    SDL_UnlockSurface(screen);
-    SDL_UnlockSurface(portrait);
-}
-
 // Transform physical touch coordinates to virtual (pre-rotation) coordinates
 // Physical screen: 1024x768, Virtual portrait: 768x1024
 static void transform_touch(UIState *ui, int *x, int *y) {
@@ -371,6 +438,7 @@ int ui_scan_directory(UIState *ui, const char *path) {
     // Sort: parent, directories, files
     qsort(ui->files, ui->file_count, sizeof(FileEntry), compare_files);
 
+    ui_invalidate(ui, NULL);
     return 0;
 }
 
@@ -385,7 +453,8 @@ int ui_open_comic(UIState *ui, const char *filepath) {
         return -1;
     }
 
-    cache_init(&ui->cache, &ui->comic);
+    cache_init(&ui->cache, &ui->comic, (size_t)ui->cloud_config.cache_budget_mb * 1024 * 1024,
+               (long long)ui->cloud_config.disk_cache_mb * 1024 * 1024);
     ui->current_page = 0;
     ui->zoom = 1.0f;
     ui->pan_x = 0;
@@ -396,7 +465,8 @@ int ui_open_comic(UIState *ui, const char *filepath) {
 }
 
 void ui_close_comic(UIState *ui) {
-    cache_clear(&ui->cache);
+    report_latency(ui);
+    cache_destroy(&ui->cache);
     cbz_close(&ui->comic);
     ui->current_page = 0;
 }
@@ -412,6 +482,7 @@ void ui_next_page(UIState *ui) {
     if (ui->current_page < ui->comic.page_count - 1) {
         ui->current_page++;
         reset_view(ui);
+        ui_invalidate(ui, NULL);
     }
 }
 
@@ -419,12 +490,14 @@ void ui_prev_page(UIState *ui) {
     if (ui->current_page > 0) {
         ui->current_page--;
         reset_view(ui);
+        ui_invalidate(ui, NULL);
     }
 }
 
 void ui_goto_page(UIState *ui, int page) {
     if (page >= 0 && page < ui->comic.page_count) {
         ui->current_page = page;
+        ui_invalidate(ui, NULL);
     }
 }
 
@@ -496,70 +569,87 @@ static void render_browser(UIState *ui, SDL_Surface *surface, int vw, int vh) {
     draw_text(surface, ui->font_small, "Tap to select | Swipe to scroll", 20, vh - 24, COLOR_GRAY);
 }
 
-// Scaled blit helper (no rotation - rotation handled by whole-screen rotate)
-static void blit_scaled(SDL_Surface *src, SDL_Surface *dst,
+// Nearest neighbour scale of (src_x, src_y, src_w, src_h) of src into
+// (dst_x, dst_y, dst_w, dst_h) of the view
+static void blit_scaled(View *view, SDL_Surface *src,
+                        int src_x, int src_y, int src_w, int src_h,
                         int dst_x, int dst_y, int dst_w, int dst_h) {
-    SDL_LockSurface(src);
-    SDL_LockSurface(dst);
-
-    int bpp = src->format->BytesPerPixel;
-    int dst_bpp = dst->format->BytesPerPixel;
-    float scale_x = (float)src->w / dst_w;
-    float scale_y = (float)src->h / dst_h;
+    if (dst_w <= 0 || dst_h <= 0) {
+        return;
+    }
 
+    // Source column of each destination column, row of each row
+    int *xmap = (int *)malloc((dst_w + dst_h) * sizeof(int));
+    if (!xmap) {
+        return;
+    }
+    int *ymap = xmap + dst_w;
+    for (int dx = 0; dx < dst_w; dx++) {
+        int sx = src_x + (int)((long long)dx * src_w / dst_w);
+        xmap[dx] = (sx < src->w) ? sx : src->w - 1;
+    }
     for (int dy = 0; dy < dst_h; dy++) {
-        int sy = (int)(dy * scale_y);
-        if (sy >= src->h) sy = src->h - 1;
-        Uint8 *src_row = (Uint8 *)src->pixels + sy * src->pitch;
-        Uint8 *dst_row = (Uint8 *)dst->pixels + (dst_y + dy) * dst->pitch;
-
-        for (int dx = 0; dx < dst_w; dx++) {
-            int sx = (int)(dx * scale_x);
-            if (sx >= src->w) sx = src->w - 1;
-            Uint8 *src_pixel = src_row + sx * bpp;
-            Uint8 *dst_pixel = dst_row + (dst_x + dx) * dst_bpp;
-
-            if (bpp == 4 && dst_bpp == 4) {
-                *(Uint32 *)dst_pixel = *(Uint32 *)src_pixel;
-            } else if (bpp >= 3) {
-                dst_pixel[0] = src_pixel[0];
-                dst_pixel[1] = src_pixel[1];
-                dst_pixel[2] = src_pixel[2];
-            }
-        }
+        int sy = src_y + (int)((long long)dy * src_h / dst_h);
+        ymap[dy] = (sy < src->h) ? sy : src->h - 1;
     }
 
-    SDL_UnlockSurface(dst);
-    SDL_UnlockSurface(src);
+    view_blit_mapped(view, src, xmap, ymap, dst_x, dst_y, dst_w, dst_h);
+    free(xmap);
 }
 
-static void render_reader(UIState *ui, SDL_Surface *surface, int vw, int vh) {
-    // Get current page
-    SDL_Surface *page = cache_get_page(&ui->cache, ui->current_page);
+// Returns 1 if the page area went straight onto the screen (portrait),
+// leaving only the status bar on the render surface to rotate
+static int render_reader(UIState *ui, SDL_Surface *surface, int vw, int vh) {
+    // Get current page (or the last ready page while it decodes)
+    int ready;
+    SDL_Surface *page = cache_get_page(&ui->cache, ui->current_page, &ready);
+
+    // Queue adjacent pages behind the current one
+    cache_preload_adjacent(&ui->cache, ui->current_page);
+
+    // In portrait the page is drawn onto the screen with the rotation
+    // folded in, skipping the portrait surface. Placeholder and failed
+    // pages have text over them, they take the portrait surface as before.
+    SDL_Rect clip;
+    SDL_GetClipRect(surface, &clip);
+    int direct = ui->orientation != 0 && ready && page;
+    View view;
+    if (direct) {
+        view_init(&view, ui->screen, ui->orientation, &clip);
+    } else {
+        view_init(&view, surface, 0, &clip);
+    }
+
+    SDL_Rect page_area = {0, 0, vw, vh - 40};
+    view_fill(&view, &page_area, SDL_MapRGB(view.surface->format, 20, 20, 25));
+
+    // Tiled high resolution level the zoomed page is drawn from, if any
+    TiledPage *tiled = NULL;
 
     if (page) {
         int view_w = vw;
         int view_h = vh - 40;  // Account for status bar
 
         if (ui->zoom <= 1.01f) {
-            // Normal view - scale to fit screen
-            float scale_x = (float)view_w / page->w;
-            float scale_y = (float)view_h / page->h;
+            // Normal view - the page's fit-to-view level is drawn as is
+            SDL_Surface *fit = cache_get_fit_level(&ui->cache, page, view_w, view_h);
+
+            float scale_x = (float)view_w / fit->w;
+            float scale_y = (float)view_h / fit->h;
             float scale = (scale_x < scale_y) ? scale_x : scale_y;
             if (scale > 1.0f) scale = 1.0f;  // Don't upscale
 
-            int dst_w = (int)(page->w * scale);
-            int dst_h = (int)(page->h * scale);
+            int dst_w = (int)(fit->w * scale);
+            int dst_h = (int)(fit->h * scale);
             int dst_x = (view_w - dst_w) / 2;
             int dst_y = (view_h - dst_h) / 2;
 
             if (scale >= 0.99f) {
                 // No scaling needed - direct blit
-                SDL_Rect dest = {dst_x, dst_y, 0, 0};
-                SDL_BlitSurface(page, NULL, surface, &dest);
+                view_blit(&view, fit, NULL, dst_x, dst_y);
             } else {
-                // Scale down
-                blit_scaled(page, surface, dst_x, dst_y, dst_w, dst_h);
+                // Fit level couldn't be made, scale down
+                blit_scaled(&view, fit, 0, 0, fit->w, fit->h, dst_x, dst_y, dst_w, dst_h);
             }
         } else {
             // Zoomed view - scale based on zoom level
@@ -567,23 +657,29 @@ static void render_reader(UIState *ui, SDL_Surface *surface, int vw, int vh) {
             float cache_scale = 1.5f;
             float effective_zoom = ui->zoom / cache_scale;  // How much to scale the cached image
 
-            // Source view size (how much of the cached image we show)
+            // Past 1.5x draw from the tiled high resolution level, with the
+            // cache level standing in for tiles not decoded yet
+            tiled = cache_get_tiled_level(&ui->cache, page, effective_zoom, &effective_zoom);
+            int level_w = tiled ? tiled->width : page->w;
+            int level_h = tiled ? tiled->height : page->h;
+
+            // Source view size (how much of the level we show)
             int src_view_w = (int)(view_w / effective_zoom);
             int src_view_h = (int)(view_h / effective_zoom);
 
-            // Clamp to page bounds
-            if (src_view_w > page->w) src_view_w = page->w;
-            if (src_view_h > page->h) src_view_h = page->h;
+            // Clamp to level bounds
+            if (src_view_w > level_w) src_view_w = level_w;
+            if (src_view_h > level_h) src_view_h = level_h;
 
             // Pan offset determines which part of source to show
-            int src_x = (page->w - src_view_w) / 2 - (int)(ui->pan_x / effective_zoom);
-            int src_y = (page->h - src_view_h) / 2 - (int)(ui->pan_y / effective_zoom);
+            int src_x = (level_w - src_view_w) / 2 - (int)(ui->pan_x / effective_zoom);
+            int src_y = (level_h - src_view_h) / 2 - (int)(ui->pan_y / effective_zoom);
 
             // Clamp source position
             if (src_x < 0) src_x = 0;
             if (src_y < 0) src_y = 0;
-            if (src_x + src_view_w > page->w) src_x = page->w - src_view_w;
-            if (src_y + src_view_h > page->h) src_y = page->h - src_view_h;
+            if (src_x + src_view_w > level_w) src_x = level_w - src_view_w;
+            if (src_y + src_view_h > level_h) src_y = level_h - src_view_h;
             if (src_x < 0) src_x = 0;
             if (src_y < 0) src_y = 0;
 
@@ -602,43 +698,42 @@ static void render_reader(UIState *ui, SDL_Surface *surface, int vw, int vh) {
             int dst_x = (view_w - dst_w) / 2;
             int dst_y = (view_h - dst_h) / 2;
 
-            // Scale and blit the visible portion
-            SDL_LockSurface(page);
-            SDL_LockSurface(surface);
-
-            int bpp = page->format->BytesPerPixel;
-            int dst_bpp = surface->format->BytesPerPixel;
-
-            for (int dy = 0; dy < dst_h; dy++) {
-                int sy = src_y + (int)(dy * src_view_h / dst_h);
-                if (sy >= page->h) sy = page->h - 1;
-                Uint8 *src_row = (Uint8 *)page->pixels + sy * page->pitch;
-                Uint8 *dst_row = (Uint8 *)surface->pixels + (dst_y + dy) * surface->pitch;
-
-                for (int dx = 0; dx < dst_w; dx++) {
-                    int sx = src_x + (int)(dx * src_view_w / dst_w);
-                    if (sx >= page->w) sx = page->w - 1;
-                    Uint8 *src_pixel = src_row + sx * bpp;
-                    Uint8 *dst_pixel = dst_row + (dst_x + dx) * dst_bpp;
-
-                    if (bpp == 4 && dst_bpp == 4) {
-                        *(Uint32 *)dst_pixel = *(Uint32 *)src_pixel;
-                    } else if (bpp >= 3) {
-                        dst_pixel[0] = src_pixel[0];
-                        dst_pixel[1] = src_pixel[1];
-                        dst_pixel[2] = src_pixel[2];
-                    }
-                }
+            if (tiled) {
+                // Only the tiles on screen (and a ring around) are kept
+                cache_show_tiles(&ui->cache, src_x, src_y, src_view_w, src_view_h);
+                tiles_draw(tiled, page, &view, src_x, src_y, src_view_w, src_view_h,
+                           dst_x, dst_y, dst_w, dst_h);
+            } else if (src_view_w == dst_w && src_view_h == dst_h) {
+                // The level matches the zoom: plain copy of the visible portion
+                SDL_Rect src_rect = {src_x, src_y, src_view_w, src_view_h};
+                view_blit(&view, page, &src_rect, dst_x, dst_y);
+            } else {
+                // Scale and blit the visible portion
+                blit_scaled(&view, page, src_x, src_y, src_view_w, src_view_h,
+                            dst_x, dst_y, dst_w, dst_h);
             }
-
-            SDL_UnlockSurface(surface);
-            SDL_UnlockSurface(page);
         }
+    }
 
-        // Preload adjacent pages
-        cache_preload_adjacent(&ui->cache, ui->current_page);
-    } else {
+    // Tiles are dropped as soon as they're off screen
+    if (!tiled) {
+        cache_show_tiles(&ui->cache, 0, 0, 0, 0);
+    }
+
+    // Placeholder pages and missing tiles are redrawn as decodes finish
+    ui->page_pending = !ready;
+    ui->reader_waiting = !ready || tiled != NULL;
+
+    if (!ready) {
         draw_text(surface, ui->font, "Loading page...", vw/2 - 60, vh/2, COLOR_WHITE);
+    } else if (!page) {
+        draw_text(surface, ui->font, "Failed to load page", vw/2 - 90, vh/2, COLOR_WHITE);
+    }
+
+    // The status bar only changes with the page or zoom; skip its text
+    // while only the page is redrawn (panning, tiles arriving)
+    if (clip.y + clip.h <= vh - 40) {
+        return direct;
     }
 
     // Page indicator bar at bottom
@@ -661,6 +756,7 @@ static void render_reader(UIState *ui, SDL_Surface *surface, int vw, int vh) {
         draw_text(surface, ui->font_small, "Tap: next zoom | Pan to move", vw/2 - 100, vh - 30, COLOR_GRAY);
     }
     draw_text(surface, ui->font_small, "[Back]", vw - 80, vh - 30, COLOR_YELLOW);
+    return direct;
 }
 
 // Check if a filename is a comic file
@@ -824,20 +920,47 @@ static void render_error(UIState *ui, SDL_Surface *surface, int vw, int vh) {
 }
 
 void ui_render(UIState *ui) {
+    // Pick up pages finished by the decode workers, redrawing the page on
+    // screen if it was waiting for them. Prefetch is planned again either
+    // way, sizes of pages just decoded may let more pages fit the budget.
+    if (ui->state == SCREEN_READER && cache_pump(&ui->cache) > 0) {
+        if (ui->reader_waiting) {
+            invalidate_page_area(ui);
+        } else {
+            cache_preload_adjacent(&ui->cache, ui->current_page);
+        }
+    }
+
+    // Nothing changed since the last frame
+    if (ui->damage_count == 0) {
+        return;
+    }
+
     // Get virtual dimensions and render surface
     int vw, vh;
     get_virtual_size(ui, &vw, &vh);
     SDL_Surface *surface = get_render_surface(ui);
 
-    // Clear render surface
-    SDL_FillRect(surface, NULL, SDL_MapRGB(surface->format, 20, 20, 25));
+    // Redraw everything covering the damage, clipped so the rest stays
+    SDL_Rect bounds = ui->damage[0];
+    for (int i = 1; i < ui->damage_count; i++) {
+        union_rect(&bounds, &ui->damage[i]);
+    }
+    SDL_SetClipRect(surface, &bounds);
+
+    // Clear render surface (the reader clears its page area itself, where
+    // it draws the page)
+    if (ui->state != SCREEN_READER) {
+        SDL_FillRect(surface, NULL, SDL_MapRGB(surface->format, 20, 20, 25));
+    }
 
+    int page_direct = 0;
     switch (ui->state) {
         case SCREEN_BROWSER:
             render_browser(ui, surface, vw, vh);
             break;
         case SCREEN_READER:
-            render_reader(ui, surface, vw, vh);
+            page_direct = render_reader(ui, surface, vw, vh);
             break;
         case SCREEN_LOADING:
             render_loading(ui, surface, vw, vh);
@@ -853,19 +976,46 @@ void ui_render(UIState *ui) {
             break;
     }
 
-    // For portrait modes, blit the rotated portrait surface to the screen
-    if (ui->orientation != 0 && portrait_surface) {
-        blit_portrait_to_screen(portrait_surface, ui->screen, ui->orientation);
+    SDL_SetClipRect(surface, NULL);
+
+    // Push only the damaged areas; for portrait modes rotate just those
+    // parts of the portrait surface onto the screen, or only the status bar
+    // when the page is on the screen already
+    SDL_Rect rects[UI_MAX_DAMAGE];
+    View screen_view;
+    view_init(&screen_view, ui->screen, ui->orientation, NULL);
+    for (int i = 0; i < ui->damage_count; i++) {
+        SDL_Rect area = ui->damage[i];
+        view_rect_on_surface(&screen_view, &area, &rects[i]);
+        if (ui->orientation == 0 || !portrait_surface) {
+            continue;
+        }
+
+        if (page_direct) {
+            int y1 = area.y + area.h;
+            if (area.y < vh - 40) area.y = vh - 40;
+            if (y1 <= area.y) continue;
+            area.h = y1 - area.y;
+        }
+        SDL_Rect out;
+        view_rect_on_surface(&screen_view, &area, &out);
+        rotate_90(portrait_surface, ui->screen, ui->orientation == 2, &out);
     }
+    SDL_UpdateRects(ui->screen, ui->damage_count, rects);
+    ui->damage_count = 0;
 
-    SDL_Flip(ui->screen);
+    // A page turn is only done once the page replaces the placeholder
+    if (ui->input_pending &&
+        !(ui->input_kind == LATENCY_PAGE_TURN && ui->state == SCREEN_READER && ui->page_pending)) {
+        record_latency(ui);
+    }
 }
 
 static int point_in_rect(int px, int py, int x, int y, int w, int h) {
     return px >= x && px < x + w && py >= y && py < y + h;
 }
 
-int ui_handle_event(UIState *ui, SDL_Event *event) {
+static int handle_event(UIState *ui, SDL_Event *event) {
     if (event->type == SDL_QUIT) {
         return 1; // Quit
     }
@@ -908,6 +1058,7 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
             if (max_scroll < 0) max_scroll = 0;
             if (*scroll_ptr < 0) *scroll_ptr = 0;
             if (*scroll_ptr > max_scroll) *scroll_ptr = max_scroll;
+            ui_invalidate(ui, NULL);
         }
 
         // Panning when zoomed in reader
@@ -918,6 +1069,7 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
                 ui->touch_start_x = tx;
                 ui->touch_start_y = ty;
                 ui->touch_moved = 1;  // Always mark as moved when panning
+                invalidate_page_area(ui);
             }
         }
     }
@@ -931,6 +1083,11 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
         int vw, vh;
         get_virtual_size(ui, &vw, &vh);
 
+        // Taps outside the reader change the selection, fields or screen
+        if (ui->state != SCREEN_READER) {
+            ui_invalidate(ui, NULL);
+        }
+
         if (ui->state == SCREEN_BROWSER && !ui->touch_moved) {
             // Check Cloud button in header
             if (y < 50 && x > vw - 90) {
@@ -996,6 +1153,7 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
                         ui->pan_x = 0;
                         ui->pan_y = 0;
                     }
+                    ui_invalidate(ui, NULL);
                 }
             } else {
                 // Swipe/drag
@@ -1176,6 +1334,7 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
         } else if (ui->state == SCREEN_CLOUD_BROWSER) {
             if (event->key.keysym.sym == SDLK_ESCAPE) {
                 ui->state = SCREEN_BROWSER;
+                ui_invalidate(ui, NULL);
             }
         } else if (ui->state == SCREEN_CLOUD_CONFIG) {
             char *target = NULL;
@@ -1191,6 +1350,17 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
                 int len = strlen(target);
                 SDLKey key = event->key.keysym.sym;
 
+                // Typing only changes the field's row (text may run past
+                // the field), anything else can move the focus
+                int vw, vh;
+                get_virtual_size(ui, &vw, &vh);
+                SDL_Rect row = {0, 140 + ui->config_input_field * 90 + 25, vw, 40};
+                if (key == SDLK_RETURN || key == SDLK_TAB || key == SDLK_ESCAPE) {
+                    ui_invalidate(ui, NULL);
+                } else {
+                    ui_invalidate(ui, &row);
+                }
+
                 if (key == SDLK_BACKSPACE && len > 0) {
                     target[len - 1] = '\0';
                 }
@@ -1225,12 +1395,51 @@ int ui_handle_event(UIState *ui, SDL_Event *event) {
     return 0;
 }
 
+int ui_handle_event(UIState *ui, SDL_Event *event) {
+    Uint32 now = SDL_GetTicks();
+    int page = ui->current_page;
+    float zoom = ui->zoom;
+    float pan_x = ui->pan_x;
+    float pan_y = ui->pan_y;
+
+    int result = handle_event(ui, event);
+
+    // Time inputs handled here to the frame showing them; actions main
+    // carries out (opening comics, cloud requests) aren't counted
+    int input = event->type == SDL_MOUSEBUTTONUP || event->type == SDL_MOUSEMOTION ||
+                event->type == SDL_KEYDOWN;
+    if (!input || result != 0 || ui->damage_count == 0) {
+        return result;
+    }
+
+    LatencyKind kind = LATENCY_OTHER;
+    if (ui->state == SCREEN_READER && ui->current_page != page) {
+        kind = LATENCY_PAGE_TURN;
+    } else if (ui->state == SCREEN_READER && ui->zoom != zoom) {
+        kind = LATENCY_ZOOM;
+    } else if (ui->state == SCREEN_READER && (ui->pan_x != pan_x || ui->pan_y != pan_y)) {
+        kind = LATENCY_PAN;
+    }
+
+    // Inputs landing in the same frame are timed from the first one
+    if (!ui->input_pending) {
+        ui->input_pending = 1;
+        ui->input_time = now;
+        ui->input_kind = kind;
+    } else if (kind < ui->input_kind) {
+        ui->input_kind = kind;
+    }
+
+    return result;
+}
+
 // Cloud browser functions
 
 int ui_scan_cloud_directory(UIState *ui, const char *path) {
     filelist_init(&ui->cloud_files);
     ui->cloud_scroll_offset = 0;
     ui->cloud_selected_file = 0;
+    ui_invalidate(ui, NULL);
 
     if (webdav_list_directory(&ui->cloud_config, path, &ui->cloud_files) != 0) {
         fprintf(stderr, "Failed to list cloud directory: %s\n", webdav_get_error());
@@ -19,6 +19,16 @@
 // Orientation debounce time in milliseconds
 #define ORIENTATION_DEBOUNCE_MS 400
 
+// The orientation sensor has no events; a timer wakes the main loop this
+// often to poll it
+#define ORIENTATION_POLL_MS 100
+
+// SDL_USEREVENT code pushed by the sensor timer (cache.h uses 1)
+#define UI_EVENT_SENSOR 2
+
+// Damaged screen areas tracked between frames; more are merged into one
+#define UI_MAX_DAMAGE 8
+
 typedef enum {
     SCREEN_BROWSER,
     SCREEN_READER,
@@ -28,6 +38,21 @@ typedef enum {
     SCREEN_CLOUD_CONFIG
 } ScreenState;
 
+// What an input changed, for input-to-screen latency
+typedef enum {
+    LATENCY_PAGE_TURN,               // Until the new page is on screen
+    LATENCY_ZOOM,
+    LATENCY_PAN,
+    LATENCY_OTHER,
+    LATENCY_KINDS
+} LatencyKind;
+
+typedef struct {
+    unsigned int count;
+    Uint32 total_ms;
+    Uint32 max_ms;
+} LatencyStats;
+
 typedef enum {
     ENTRY_FILE,
     ENTRY_DIRECTORY,
@@ -75,6 +100,19 @@ typedef struct {
     int pending_orientation;         // Orientation we're considering switching to
     Uint32 orientation_change_time;  // When pending_orientation was first detected
 
+    // Damage tracking (virtual screen coordinates): only these areas are
+    // redrawn and pushed to the screen, frames without any are skipped
+    SDL_Rect damage[UI_MAX_DAMAGE];
+    int damage_count;
+    int reader_waiting;              // Page on screen changes as decodes finish
+    int page_pending;                // Page on screen is a placeholder
+
+    // Input-to-screen latency, reported when a comic is closed
+    int input_pending;               // 1 if an input isn't on screen yet
+    Uint32 input_time;               // Ticks when the oldest such input came in
+    LatencyKind input_kind;          // Most important thing it changed
+    LatencyStats latency[LATENCY_KINDS];
+
     // Cloud browser state
     int browse_mode;                 // 0=local, 1=cloud
     char cloud_path[MAX_PATH_LEN];
@@ -96,12 +134,16 @@ typedef struct {
 int ui_init(UIState *ui);
 void ui_cleanup(UIState *ui);
 
-// Event handling - returns action code
+// Event handling - returns action code. Inputs are timed until the frame
+// showing what they changed is pushed.
 int ui_handle_event(UIState *ui, SDL_Event *event);
 
-// Rendering
+// Rendering - redraws the damaged areas, does nothing if there are none
 void ui_render(UIState *ui);
 
+// Mark an area of the virtual screen as changed, NULL for all of it
+void ui_invalidate(UIState *ui, const SDL_Rect *area);
+
 // File browser
 int ui_scan_directory(UIState *ui, const char *path);
 
@@ -116,7 +158,7 @@ void ui_goto_page(UIState *ui, int page);
 void ui_set_screen(UIState *ui, ScreenState state);
 void ui_set_message(UIState *ui, const char *message);
 
-// Orientation
+// Orientation - poll after handling events; UI_EVENT_SENSOR wakes the loop for it
 void ui_poll_orientation(UIState *ui);
 
 // Cloud browser
@@ -90,7 +90,12 @@ time64_t ar_conv_dosdate_to_filetime(uint32_t dosdate)
     tm.tm_isdst = -1;
 
     t1 = mktime(&tm);
+#ifdef _WIN32
     t2 = mktime(gmtime(&t1));
+#else
+    /* gmtime's static buffer isn't safe with archives parsed on several threads */
+    t2 = mktime(gmtime_r(&t1, &tm));
+#endif
 
     return (time64_t)(2 * t1 - t2 + 11644473600) * 10000000;
 }
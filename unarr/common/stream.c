@@ -155,6 +155,58 @@ ar_stream *ar_open_memory(const void *data, size_t datalen)
     return ar_open_stream(stm, memory_close, memory_read, memory_seek, memory_tell);
 }
 
+/***** stream based on a memory mapped file *****/
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct MappedStream {
+    struct MemoryStream mem;
+    void *map;
+};
+
+static void mapped_close(void *data)
+{
+    struct MappedStream *stm = data;
+    munmap(stm->map, stm->mem.length);
+    free(stm);
+}
+
+ar_stream *ar_open_mapped_file(const char *path)
+{
+    struct MappedStream *stm;
+    struct stat st;
+    void *map = MAP_FAILED;
+    int fd = path ? open(path, O_RDONLY) : -1;
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0 && (off64_t)(size_t)st.st_size == (off64_t)st.st_size)
+        map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return ar_open_file(path);
+
+    stm = malloc(sizeof(struct MappedStream));
+    if (!stm) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    stm->mem.data = map;
+    stm->mem.length = (size_t)st.st_size;
+    stm->mem.offset = 0;
+    stm->map = map;
+    return ar_open_stream(stm, mapped_close, memory_read, memory_seek, memory_tell);
+}
+#else
+ar_stream *ar_open_mapped_file(const char *path)
+{
+    return ar_open_file(path);
+}
+#endif
+
 #ifdef _WIN32
 /***** stream based on IStream *****/
 
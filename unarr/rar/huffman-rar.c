@@ -141,6 +141,41 @@ bool rar_make_table(struct huffman_code *code)
     return rar_make_table_rec(code, 0, 0, 0, code->tablesize);
 }
 
+bool rar_copy_code(struct huffman_code *dst, const struct huffman_code *src)
+{
+    *dst = *src;
+    dst->tree = NULL;
+    dst->table = NULL;
+    if (src->tree) {
+        dst->tree = malloc(src->capacity * sizeof(*src->tree));
+        if (!dst->tree)
+            goto CopyError;
+        memcpy(dst->tree, src->tree, src->capacity * sizeof(*src->tree));
+    }
+    if (src->table) {
+        dst->table = malloc((1ULL << src->tablesize) * sizeof(*src->table));
+        if (!dst->table)
+            goto CopyError;
+        memcpy(dst->table, src->table, (1ULL << src->tablesize) * sizeof(*src->table));
+    }
+    return true;
+
+CopyError:
+    warn("OOM during decompression");
+    rar_free_code(dst);
+    return false;
+}
+
+size_t rar_code_size(const struct huffman_code *code)
+{
+    size_t size = 0;
+    if (code->tree)
+        size += code->capacity * sizeof(*code->tree);
+    if (code->table)
+        size += (size_t)(1ULL << code->tablesize) * sizeof(*code->table);
+    return size;
+}
+
 void rar_free_code(struct huffman_code *code)
 {
     free(code->tree);
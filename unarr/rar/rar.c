@@ -3,11 +3,115 @@
 
 #include "rar.h"
 
+/***** checkpoints *****/
+
+/* decompression state right before a solid entry (see ar_rar_set_checkpoints) */
+struct rar_checkpoint {
+    off64_t entry_offset;
+    uint32_t entry_number;
+    size_t size_total;
+    size_t size;
+    struct ar_archive_rar_uncomp uncomp;
+    struct rar_checkpoint *next;
+};
+
+static void rar_free_checkpoints(struct ar_archive_rar_checkpoints *checkpoints)
+{
+    while (checkpoints->list) {
+        struct rar_checkpoint *next = checkpoints->list->next;
+        rar_clear_uncompress(&checkpoints->list->uncomp);
+        free(checkpoints->list);
+        checkpoints->list = next;
+    }
+    checkpoints->used_bytes = 0;
+}
+
+/* drops every other checkpoint by doubling the interval */
+static void rar_thin_checkpoints(struct ar_archive_rar_checkpoints *checkpoints)
+{
+    struct rar_checkpoint **cp = &checkpoints->list;
+    checkpoints->interval *= 2;
+    while (*cp) {
+        struct rar_checkpoint *next = (*cp)->next;
+        if ((*cp)->entry_number % checkpoints->interval != 0) {
+            checkpoints->used_bytes -= (*cp)->size;
+            rar_clear_uncompress(&(*cp)->uncomp);
+            free(*cp);
+            *cp = next;
+        }
+        else
+            cp = &(*cp)->next;
+    }
+}
+
+/* returns the last checkpoint at or before the given entry offset */
+static struct rar_checkpoint *rar_find_checkpoint(ar_archive_rar *rar, off64_t offset)
+{
+    struct rar_checkpoint *cp, *found = NULL;
+    for (cp = rar->checkpoints.list; cp && cp->entry_offset <= offset; cp = cp->next)
+        found = cp;
+    return found;
+}
+
+static void rar_save_checkpoint(ar_archive_rar *rar)
+{
+    struct ar_archive_rar_checkpoints *checkpoints = &rar->checkpoints;
+    struct rar_checkpoint *cp, **pos;
+    size_t size;
+
+    if (!checkpoints->interval || rar->solid.entry_number % checkpoints->interval != 0)
+        return;
+    cp = rar_find_checkpoint(rar, rar->super.entry_offset);
+    if (cp && cp->entry_offset == rar->super.entry_offset)
+        return;
+    size = rar_uncompress_copy_size(&rar->uncomp);
+    if (!size)
+        return;
+    size += sizeof(*cp);
+    while (checkpoints->list && checkpoints->used_bytes + size > checkpoints->max_bytes && checkpoints->interval < UINT32_MAX / 2)
+        rar_thin_checkpoints(checkpoints);
+    if (checkpoints->used_bytes + size > checkpoints->max_bytes || rar->solid.entry_number % checkpoints->interval != 0)
+        return;
+
+    cp = calloc(1, sizeof(*cp));
+    if (!cp)
+        return;
+    if (!rar_copy_uncompress(&cp->uncomp, &rar->uncomp, false)) {
+        free(cp);
+        return;
+    }
+    cp->entry_offset = rar->super.entry_offset;
+    cp->entry_number = rar->solid.entry_number;
+    cp->size_total = rar->solid.size_total;
+    cp->size = size;
+
+    for (pos = &checkpoints->list; *pos && (*pos)->entry_offset < cp->entry_offset; pos = &(*pos)->next);
+    cp->next = *pos;
+    *pos = cp;
+    checkpoints->used_bytes += size;
+    log("Saved solid checkpoint @%" PRIi64 " (%" PRIuPTR " bytes)", cp->entry_offset, size);
+}
+
+static bool rar_restore_checkpoint(ar_archive_rar *rar, struct rar_checkpoint *cp)
+{
+    rar_clear_uncompress(&rar->uncomp);
+    if (!rar_copy_uncompress(&rar->uncomp, &cp->uncomp, true)) {
+        memset(&rar->uncomp, 0, sizeof(rar->uncomp));
+        return false;
+    }
+    rar->solid.size_total = cp->size_total;
+    rar->solid.entry_number = cp->entry_number;
+    return true;
+}
+
+/***** rar *****/
+
 static void rar_close(ar_archive *ar)
 {
     ar_archive_rar *rar = (ar_archive_rar *)ar;
     free(rar->entry.name);
     rar_clear_uncompress(&rar->uncomp);
+    rar_free_checkpoints(&rar->checkpoints);
 }
 
 static bool rar_parse_entry(ar_archive *ar, off64_t offset)
@@ -77,6 +181,9 @@ static bool rar_parse_entry(ar_archive *ar, off64_t offset)
             }
             else {
                 br_clear_leftover_bits(&rar->uncomp);
+                rar->solid.entry_number++;
+                if (rar->solid.part_done && ar->entry_size_uncompressed > 0)
+                    rar_save_checkpoint(rar);
             }
 
             rar->solid.restart = rar->entry.solid && (out_of_order || !rar->solid.part_done);
@@ -136,10 +243,24 @@ static bool rar_restart_solid(ar_archive *ar)
 {
     ar_archive_rar *rar = (ar_archive_rar *)ar;
     off64_t current_offset = ar->entry_offset;
-    log("Restarting decompression for solid entry");
-    if (!ar_parse_entry_at(ar, ar->entry_offset_first)) {
-        ar_parse_entry_at(ar, current_offset);
-        return false;
+    struct rar_checkpoint *cp = rar_find_checkpoint(rar, current_offset);
+    if (cp) {
+        log("Resuming decompression for solid entry from checkpoint @%" PRIi64, cp->entry_offset);
+        if (cp->entry_offset != current_offset && !ar_parse_entry_at(ar, cp->entry_offset)) {
+            ar_parse_entry_at(ar, current_offset);
+            return false;
+        }
+        if (!rar_restore_checkpoint(rar, cp)) {
+            ar_parse_entry_at(ar, current_offset);
+            return false;
+        }
+    }
+    else {
+        log("Restarting decompression for solid entry");
+        if (!ar_parse_entry_at(ar, ar->entry_offset_first)) {
+            ar_parse_entry_at(ar, current_offset);
+            return false;
+        }
     }
     while (ar->entry_offset < current_offset) {
         size_t size = ar->entry_size_uncompressed;
@@ -221,3 +342,23 @@ ar_archive *ar_open_rar_archive(ar_stream *stream)
 
     return ar_open_archive(stream, sizeof(ar_archive_rar), rar_close, rar_parse_entry, rar_get_name, rar_uncompress, NULL, FILE_SIGNATURE_SIZE);
 }
+
+void ar_rar_set_checkpoints(ar_archive *ar, uint32_t interval, size_t max_bytes)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    rar_free_checkpoints(&rar->checkpoints);
+    rar->checkpoints.interval = interval;
+    rar->checkpoints.max_bytes = max_bytes;
+}
+
+off64_t ar_rar_get_checkpoint(ar_archive *ar, off64_t offset)
+{
+    struct rar_checkpoint *cp = rar_find_checkpoint((ar_archive_rar *)ar, offset);
+    return cp ? cp->entry_offset : 0;
+}
+
+bool ar_rar_is_solid(ar_archive *ar)
+{
+    ar_archive_rar *rar = (ar_archive_rar *)ar;
+    return (rar->archive_flags & MHD_SOLID) != 0;
+}
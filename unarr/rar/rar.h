@@ -121,6 +121,8 @@ bool rar_new_node(struct huffman_code *code);
 bool rar_add_value(struct huffman_code *code, int value, int codebits, int length);
 bool rar_create_code(struct huffman_code *code, uint8_t *lengths, int numsymbols);
 bool rar_make_table(struct huffman_code *code);
+bool rar_copy_code(struct huffman_code *dst, const struct huffman_code *src);
+size_t rar_code_size(const struct huffman_code *code);
 void rar_free_code(struct huffman_code *code);
 
 static inline bool rar_is_leaf_node(struct huffman_code *code, int node) { return code->tree[node].branches[0] == code->tree[node].branches[1]; }
@@ -215,6 +217,8 @@ struct ar_archive_rar_uncomp {
 bool rar_uncompress_part(ar_archive_rar *rar, void *buffer, size_t buffer_size);
 int64_t rar_expand(ar_archive_rar *rar, int64_t end);
 void rar_clear_uncompress(struct ar_archive_rar_uncomp *uncomp);
+size_t rar_uncompress_copy_size(const struct ar_archive_rar_uncomp *uncomp);
+bool rar_copy_uncompress(struct ar_archive_rar_uncomp *dst, const struct ar_archive_rar_uncomp *src, bool full_window);
 static inline void br_clear_leftover_bits(struct ar_archive_rar_uncomp *uncomp) { uncomp->br.available &= ~0x07; }
 
 /***** rar *****/
@@ -227,10 +231,20 @@ struct ar_archive_rar_progress {
 
 struct ar_archive_rar_solid {
     size_t size_total;
+    uint32_t entry_number;
     bool part_done;
     bool restart;
 };
 
+struct rar_checkpoint;
+
+struct ar_archive_rar_checkpoints {
+    struct rar_checkpoint *list;
+    uint32_t interval;
+    size_t max_bytes;
+    size_t used_bytes;
+};
+
 struct ar_archive_rar_s {
     ar_archive super;
     uint16_t archive_flags;
@@ -238,6 +252,7 @@ struct ar_archive_rar_s {
     struct ar_archive_rar_uncomp uncomp;
     struct ar_archive_rar_progress progress;
     struct ar_archive_rar_solid solid;
+    struct ar_archive_rar_checkpoints checkpoints;
 };
 
 #endif
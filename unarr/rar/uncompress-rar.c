@@ -103,6 +103,93 @@ void rar_clear_uncompress(struct ar_archive_rar_uncomp *uncomp)
     uncomp->version = 0;
 }
 
+/* the state holds pointers into the PPMd model and the filter VM; only plain LZSS states can be copied */
+static bool rar_can_copy_uncompress(const struct ar_archive_rar_uncomp *uncomp)
+{
+    const struct ar_archive_rar_uncomp_v3 *uncomp_v3 = &uncomp->state.v3;
+    if (!uncomp->version || uncomp->bytes_ready > 0)
+        return false;
+    if (uncomp->version == 3) {
+        if (Ppmd7_WasAllocated(&uncomp_v3->ppmd7_context) || uncomp_v3->filters.vm || uncomp_v3->filters.progs || uncomp_v3->filters.stack)
+            return false;
+    }
+    return true;
+}
+
+static int rar_get_codes(const struct ar_archive_rar_uncomp *uncomp, const struct huffman_code **codes)
+{
+    int i;
+    if (uncomp->version == 2) {
+        codes[0] = &uncomp->state.v2.maincode;
+        codes[1] = &uncomp->state.v2.offsetcode;
+        codes[2] = &uncomp->state.v2.lengthcode;
+        for (i = 0; i < 4; i++)
+            codes[3 + i] = &uncomp->state.v2.audiocode[i];
+        return 7;
+    }
+    codes[0] = &uncomp->state.v3.maincode;
+    codes[1] = &uncomp->state.v3.offsetcode;
+    codes[2] = &uncomp->state.v3.lowoffsetcode;
+    codes[3] = &uncomp->state.v3.lengthcode;
+    return 4;
+}
+
+/* only the part of the window that has been written to is worth keeping */
+static size_t rar_window_used(const LZSS *lzss)
+{
+    return lzss->position < lzss->mask + 1 ? (size_t)lzss->position : (size_t)lzss->mask + 1;
+}
+
+size_t rar_uncompress_copy_size(const struct ar_archive_rar_uncomp *uncomp)
+{
+    const struct huffman_code *codes[7];
+    size_t size;
+    int count, i;
+
+    if (!rar_can_copy_uncompress(uncomp))
+        return 0;
+    size = sizeof(*uncomp) + rar_window_used(&uncomp->lzss);
+    count = rar_get_codes(uncomp, codes);
+    for (i = 0; i < count; i++)
+        size += rar_code_size(codes[i]);
+    return size;
+}
+
+bool rar_copy_uncompress(struct ar_archive_rar_uncomp *dst, const struct ar_archive_rar_uncomp *src, bool full_window)
+{
+    const struct huffman_code *srccodes[7], *dstcodes[7];
+    size_t window_used = rar_window_used(&src->lzss);
+    int count, i;
+
+    if (!rar_can_copy_uncompress(src))
+        return false;
+
+    *dst = *src;
+    count = rar_get_codes(dst, dstcodes);
+    rar_get_codes(src, srccodes);
+    for (i = 0; i < count; i++) {
+        memset((struct huffman_code *)dstcodes[i], 0, sizeof(struct huffman_code));
+    }
+    if (dst->version == 3)
+        dst->state.v3.filters.bytes = NULL;
+
+    dst->lzss.window = malloc(full_window ? (size_t)src->lzss.mask + 1 : (window_used ? window_used : 1));
+    if (!dst->lzss.window)
+        goto CopyError;
+    memcpy(dst->lzss.window, src->lzss.window, window_used);
+
+    for (i = 0; i < count; i++) {
+        if (!rar_copy_code((struct huffman_code *)dstcodes[i], srccodes[i]))
+            goto CopyError;
+    }
+    return true;
+
+CopyError:
+    warn("OOM during decompression");
+    rar_clear_uncompress(dst);
+    return false;
+}
+
 static int rar_read_next_symbol(ar_archive_rar *rar, struct huffman_code *code)
 {
     int node = 0;
@@ -53,6 +53,8 @@ UNARR_EXPORT ar_stream *ar_open_file(const char *path);
 #ifdef _WIN32
 UNARR_EXPORT ar_stream *ar_open_file_w(const wchar_t *path);
 #endif
+/* opens a read-only stream backed by a memory mapping of the given file (falls back to ar_open_file if it can't be mapped); returns NULL on error */
+UNARR_EXPORT ar_stream *ar_open_mapped_file(const char *path);
 /* opens a read-only stream for the given chunk of memory; the pointer must be valid until ar_close is called */
 UNARR_EXPORT ar_stream *ar_open_memory(const void *data, size_t datalen);
 #ifdef _WIN32
@@ -109,6 +111,12 @@ UNARR_EXPORT size_t ar_get_global_comment(ar_archive *ar, void *buffer, size_t c
 
 /* checks whether 'stream' could contain RAR data and prepares for archive listing/extraction; returns NULL on failure */
 UNARR_EXPORT ar_archive *ar_open_rar_archive(ar_stream *stream);
+/* returns whether a RAR archive uses solid compression (only valid once an entry has been parsed) */
+UNARR_EXPORT bool ar_rar_is_solid(ar_archive *ar);
+/* keeps a copy of the solid decompression state every 'interval' entries (using at most 'max_bytes', thinned out as needed) so that going back in a solid archive doesn't restart at the first entry; 0 disables */
+UNARR_EXPORT void ar_rar_set_checkpoints(ar_archive *ar, uint32_t interval, size_t max_bytes);
+/* returns the offset of the last checkpointed entry at or before 'offset' for use with ar_parse_entry_at (0 if there is none) */
+UNARR_EXPORT off64_t ar_rar_get_checkpoint(ar_archive *ar, off64_t offset);
 
 /***** tar/tar *****/
 